@@ -0,0 +1,323 @@
+#include "DirectoryModel.h"
+#include "Frame.h"
+#include "RowTokenizer.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <algorithm>
+
+QString DirEntry::typeName() const {
+    switch (type) {
+    case Directory:     return QStringLiteral("DIR");
+    case Regular:       return QStringLiteral("REG");
+    case Symlink:       return QStringLiteral("LNK");
+    case BlockDevice:   return QStringLiteral("BLK");
+    case CharDevice:    return QStringLiteral("CHR");
+    case Fifo:          return QStringLiteral("FIFO");
+    case Socket:        return QStringLiteral("SOCK");
+    default:            return QStringLiteral("UNKN");
+    }
+}
+
+QString DirEntry::permissions() const {
+    static const char kTypeChar[] = { ' ', 'd', '-', 'l', 'b', 'c', ' ', ' ' };
+    char buf[10];
+
+    buf[0] = kTypeChar[type];
+    for (int i = 0; i < 9; i++) {
+        buf[1 + i] = (mode & (0400 >> i)) ? "rwxrwxrwx"[i] : '-';
+    }
+    return QString::fromLatin1(buf, sizeof(buf));
+}
+
+static DirEntry::Type typeFromName(QLatin1String name) {
+    struct { QLatin1String name; DirEntry::Type type; } static const kTypes[] = {
+        { QLatin1String("DIR"), DirEntry::Directory }, { QLatin1String("REG"), DirEntry::Regular },
+        { QLatin1String("LNK"), DirEntry::Symlink }, { QLatin1String("BLK"), DirEntry::BlockDevice },
+        { QLatin1String("CHR"), DirEntry::CharDevice }, { QLatin1String("FIFO"), DirEntry::Fifo },
+        { QLatin1String("SOCK"), DirEntry::Socket },
+    };
+    for (const auto& t : kTypes) {
+        if (t.name == name) {
+            return t.type;
+        }
+    }
+    return DirEntry::Unknown;
+}
+
+// "ino 권한 타입 uid gid atime mtime ctime nlink size 이름[ -> 대상]".
+// 필드는 버퍼 안에서 바로 잘라 숫자로 바꾼다 (이름 말고는 할당 없음)
+bool DirEntry::parse(const char* line, const char* end, DirEntry& entry) {
+    RowTokenizer row(line, end);
+    QLatin1String field[10];
+
+    for (auto& f : field) {
+        if (!row.next(f)) {
+            return false;
+        }
+    }
+    const char* p = row.rest(); // 이름 앞의 공백 하나 (이름 안의 공백은 그대로 둔다)
+    if (p == field[9].data() + field[9].size()) {
+        return false;
+    }
+
+    entry.mode = 0;
+    for (int i = 0; i < 9 && i + 1 < field[1].size(); i++) {
+        if (field[1].data()[1 + i] != '-') entry.mode |= 0400 >> i;
+    }
+    entry.type = typeFromName(field[2]);
+    if (!RowTokenizer::toUInt64(field[0], entry.inode) || !RowTokenizer::toInt64(field[6], entry.mtime) ||
+        !RowTokenizer::toInt64(field[9], entry.size)) {
+        return false;
+    }
+
+    const char* arrow = nullptr;
+    if (entry.type == Symlink) {
+        for (const char* q = p; q + 4 <= end; q++) {
+            if (memcmp(q, " -> ", 4) == 0) {
+                arrow = q;
+                break;
+            }
+        }
+    }
+    entry.name = QString::fromUtf8(p, int((arrow ? arrow : end) - p));
+    entry.linkTarget = arrow ? QString::fromUtf8(arrow + 4, int(end - arrow - 4)) : QString();
+    return true;
+}
+
+static DirEntry::Type typeFromMode(quint32 mode) {
+    switch (mode & 0170000) {
+    case 0040000:   return DirEntry::Directory;
+    case 0100000:   return DirEntry::Regular;
+    case 0120000:   return DirEntry::Symlink;
+    case 0060000:   return DirEntry::BlockDevice;
+    case 0020000:   return DirEntry::CharDevice;
+    case 0010000:   return DirEntry::Fifo;
+    case 0140000:   return DirEntry::Socket;
+    default:        return DirEntry::Unknown;
+    }
+}
+
+// Records 프레임들을 이어 붙인 것: 프레임마다 개수, 문자열 기준 위치, 레코드 배열, 문자열 테이블.
+// 필드는 고정 위치에서 바로 읽는다 (server/frame.h 참고)
+bool DirEntry::parseRecords(const QByteArray& data, QVector<DirEntry>& out) {
+    const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+    const uchar* end = p + data.size();
+
+    while (end - p >= 8) {
+        quint32 count = qFromLittleEndian<quint32>(p);
+        quint32 base = qFromLittleEndian<quint32>(p + 4);
+        const uchar* rec = p + 8;
+        if (quint64(end - rec) < quint64(count) * kRecordSize) {
+            return false;
+        }
+
+        const uchar* strs = rec + size_t(count) * kRecordSize;
+        qint64 strsLen = 0;
+        out.reserve(out.size() + int(count));
+        for (quint32 i = 0; i < count; i++, rec += kRecordSize) {
+            quint32 off = qFromLittleEndian<quint32>(rec + 24) - base;
+            quint16 nameLen = qFromLittleEndian<quint16>(rec + 28);
+            quint16 linkLen = qFromLittleEndian<quint16>(rec + 30);
+            if (qint64(off) + nameLen + linkLen > end - strs) {
+                return false;
+            }
+
+            DirEntry e;
+            e.inode = qFromLittleEndian<quint64>(rec);
+            e.size = qFromLittleEndian<qint64>(rec + 8);
+            e.mtime = qFromLittleEndian<qint64>(rec + 16);
+            quint32 mode = qFromLittleEndian<quint32>(rec + 32);
+            e.mode = mode & 0777;
+            e.type = typeFromMode(mode);
+            e.name = QString::fromUtf8(reinterpret_cast<const char*>(strs + off), nameLen);
+            if (linkLen > 0) {
+                e.linkTarget = QString::fromUtf8(reinterpret_cast<const char*>(strs + off + nameLen), linkLen);
+            }
+            out.append(e);
+            strsLen += nameLen + linkLen;
+        }
+        p = strs + strsLen;
+    }
+    return p == end;
+}
+
+DirectoryModel::DirectoryModel(QObject* parent) : QAbstractTableModel(parent) {
+}
+
+// 서버가 보낸 구간 [offset, offset + count) 의 행. offset 이 0 이면 새 목록.
+// records 이면 Records 프레임 (바이너리), 아니면 Listing 텍스트
+void DirectoryModel::setPage(int offset, int totalRows, const QByteArray& rows, bool records) {
+    QVector<DirEntry> page;
+    const char* p = rows.constData();
+    const char* end = p + rows.size();
+
+    if (records && !DirEntry::parseRecords(rows, page)) {
+        qWarning("Malformed directory records");
+    }
+
+    const char *line, *lineEnd;
+    while (!records && RowTokenizer::nextLine(p, end, line, lineEnd)) {
+        DirEntry e;
+        if (DirEntry::parse(line, lineEnd, e)) {
+            page.append(e);
+        }
+    }
+
+    pagePending = false;
+
+    if (offset == 0) {
+        beginResetModel();
+        entries = page;
+        total = totalRows;
+        endResetModel();
+        return;
+    }
+    if (offset != entries.size() || page.isEmpty()) {
+        return; // 목록을 새로 받은 뒤에 도착한 이전 페이지
+    }
+
+    total = totalRows;
+    beginInsertRows(QModelIndex(), entries.size(), entries.size() + page.size() - 1);
+    entries += page;
+    endInsertRows();
+}
+
+// 서버 정렬과 같은 순서: ".", "..", 디렉토리, 나머지. 같은 묶음 안에서는 UTF-8 바이트 순
+static int sortRank(const DirEntry& e) {
+    if (e.name == QLatin1String(".")) return 0;
+    if (e.name == QLatin1String("..")) return 1;
+    return e.isDir() ? 2 : 3;
+}
+
+static bool entryLess(const DirEntry& a, const DirEntry& b) {
+    int ra = sortRank(a), rb = sortRank(b);
+    if (ra != rb) {
+        return ra < rb;
+    }
+    return a.name.toUtf8() < b.name.toUtf8();
+}
+
+int DirectoryModel::findRow(const QString& name) const {
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void DirectoryModel::removeRow(int row) {
+    beginRemoveRows(QModelIndex(), row, row);
+    entries.remove(row);
+    endRemoveRows();
+}
+
+// 정렬 위치가 이미 받은 구간 안이면 행을 넣는다. 뒤쪽이면 다음 페이지에 포함된다
+void DirectoryModel::insertEntry(const DirEntry& e) {
+    bool allLoaded = entries.size() == total;
+    int row = int(std::lower_bound(entries.begin(), entries.end(), e, entryLess) - entries.begin());
+
+    total++;
+    if (row < entries.size() || allLoaded) {
+        beginInsertRows(QModelIndex(), row, row);
+        entries.insert(row, e);
+        endInsertRows();
+    }
+}
+
+// "+ 행" 추가, "~ 행" 변경, "- 이름" 삭제
+void DirectoryModel::applyDelta(const QByteArray& delta) {
+    const char* p = delta.constData();
+    const char* end = p + delta.size();
+    const char *line, *lineEnd;
+
+    while (RowTokenizer::nextLine(p, end, line, lineEnd)) {
+        const char op = line[0];
+
+        if (lineEnd - line > 2 && line[1] == ' ') {
+            if (op == '-') {
+                int row = findRow(QString::fromUtf8(line + 2, int(lineEnd - line - 2)));
+                if (row >= 0) {
+                    removeRow(row);
+                }
+                total--;
+            } else {
+                DirEntry e;
+                if (DirEntry::parse(line + 2, lineEnd, e)) {
+                    int row = findRow(e.name);
+                    if (row >= 0 && sortRank(entries[row]) == sortRank(e)) {
+                        entries[row] = e; // 이름이 같으면 자리도 같다
+                        emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+                    } else if (op == '+' || row >= 0) {
+                        if (row >= 0) {
+                            removeRow(row);
+                            total--;
+                        }
+                        insertEntry(e);
+                    }
+                }
+            }
+        }
+    }
+}
+
+const DirEntry* DirectoryModel::entry(int row) const {
+    return row >= 0 && row < entries.size() ? &entries[row] : nullptr;
+}
+
+int DirectoryModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : entries.size();
+}
+
+int DirectoryModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant DirectoryModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= entries.size()) {
+        return QVariant();
+    }
+
+    const DirEntry& e = entries[index.row()];
+    if (role == Qt::TextAlignmentRole && index.column() == Size) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case Permissions:
+        return e.permissions();
+    case Type:
+        return e.typeName();
+    case Modified:
+        return QDateTime::fromSecsSinceEpoch(e.mtime).toString("yyyy-MM-dd hh:mm");
+    case Size:
+        return e.size;
+    case Name:
+        return e.linkTarget.isEmpty() ? e.name : e.name + " -> " + e.linkTarget;
+    }
+    return QVariant();
+}
+
+QVariant DirectoryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    static const char* kHeaders[ColumnCount] = { "Permissions", "Type", "Modified", "Size", "Name" };
+    return section >= 0 && section < ColumnCount ? QString(kHeaders[section]) : QVariant();
+}
+
+bool DirectoryModel::canFetchMore(const QModelIndex& parent) const {
+    return !parent.isValid() && !pagePending && entries.size() < total;
+}
+
+// 뷰가 마지막 행 근처까지 스크롤하면 다음 페이지
+void DirectoryModel::fetchMore(const QModelIndex& parent) {
+    if (canFetchMore(parent)) {
+        pagePending = true;
+        emit pageRequested(entries.size());
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef DIRECTORY_MODEL_H
+#define DIRECTORY_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// 디렉토리 항목 하나 (서버 목록 한 줄을 받을 때 한 번만 파싱)
+struct DirEntry {
+    enum Type : quint8 { Unknown, Directory, Regular, Symlink, BlockDevice, CharDevice, Fifo, Socket };
+
+    QString name;
+    QString linkTarget;         // 심볼릭 링크 대상 (아니면 비어 있음)
+    quint64 inode = 0;
+    qint64 size = 0;
+    qint64 mtime = 0;           // 초 단위
+    quint32 mode = 0;           // 권한 비트 (0777)
+    Type type = Unknown;
+
+    bool isDir() const { return type == Directory; }
+    QString typeName() const;
+    QString permissions() const;
+
+    static bool parse(const char* line, const char* end, DirEntry& entry);
+    static bool parseRecords(const QByteArray& data, QVector<DirEntry>& out);
+};
+
+// 서버에서 페이지 단위로 받은 정렬된 디렉토리 목록.
+// 행은 연속된 벡터에 들고 있고 화면에 보이는 칸만 문자열로 만든다.
+// 끝까지 스크롤하면 canFetchMore/fetchMore 로 다음 페이지를 요청한다.
+// 목록을 받은 뒤의 변경은 서버가 보내는 변경분 (applyDelta) 으로만 반영한다.
+class DirectoryModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { Permissions, Type, Modified, Size, Name, ColumnCount };
+
+    explicit DirectoryModel(QObject* parent = nullptr);
+
+    void setPage(int offset, int total, const QByteArray& rows, bool records = false);
+    const DirEntry* entry(int row) const;
+    int loadedCount() const { return entries.size(); }
+    int totalCount() const { return total; }
+    quint32 version() const { return listVersion; }
+    void setVersion(quint32 v) { listVersion = v; }
+    void applyDelta(const QByteArray& delta);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+signals:
+    void pageRequested(int offset);
+
+private:
+    int findRow(const QString& name) const;
+    void insertEntry(const DirEntry& e);
+    void removeRow(int row);
+
+    QVector<DirEntry> entries;
+    int total = 0;              // 디렉토리 전체 항목 수
+    quint32 listVersion = 0;    // 서버 스냅샷 버전 (0 이면 없음)
+    bool pagePending = false;
+};
+
+#endif // DIRECTORY_MODEL_H
@@ -0,0 +1,142 @@
+#include "FileViewModel.h"
+#include <QDebug>
+#include <cstring>
+
+FileViewModel::FileViewModel(QObject* parent) : QAbstractListModel(parent) {
+}
+
+void FileViewModel::open(const QString& path) {
+    beginResetModel();
+    filePath = path;
+    blocks.clear();
+    pending.clear();
+    knownRows = 0;
+    endKnown = false;
+    endResetModel();
+
+    requestBlock(0);
+}
+
+// 파일이 바뀌었다. 받아 둔 블록을 버리고 보이는 줄부터 다시 받는다
+void FileViewModel::reload() {
+    blocks.clear();
+    pending.clear();
+    endKnown = false;
+
+    requestBlock(0); // 전체 줄 수
+    if (knownRows > 0) {
+        emit dataChanged(index(0), index(knownRows - 1));
+    }
+}
+
+void FileViewModel::requestBlock(int block) const {
+    if (pending.contains(block)) {
+        return;
+    }
+    pending.insert(block);
+    emit const_cast<FileViewModel*>(this)->rangeRequested(quint64(block) * kBlockLines, kBlockLines);
+}
+
+void FileViewModel::addBlock(quint64 firstLine, const QByteArray& bytes, quint64 totalLines) {
+    int index = int(firstLine / kBlockLines);
+    pending.remove(index);
+
+    // 줄 시작 위치 인덱스 (개행 없이 끝나는 마지막 줄도 한 줄)
+    Block block;
+    block.bytes = bytes;
+    block.lastUsed = ++useClock;
+    const char* begin = bytes.constData();
+    const char* end = begin + bytes.size();
+    for (const char* p = begin; p < end; ) {
+        block.lineStarts.append(quint32(p - begin));
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+    }
+    int lines = block.lineStarts.size();
+    blocks.insert(index, block);
+
+    // 전체 줄 수를 알게 됐거나 블록이 덜 찼으면 파일 끝
+    int rows = qMax(knownRows, int(firstLine) + lines);
+    if (totalLines != quint64(-1)) {
+        rows = int(totalLines);
+        endKnown = true;
+    } else if (lines < kBlockLines) {
+        rows = int(firstLine) + lines;
+        endKnown = true;
+    }
+
+    if (rows > knownRows) {
+        beginInsertRows(QModelIndex(), knownRows, rows - 1);
+        knownRows = rows;
+        endInsertRows();
+    } else if (rows < knownRows) {
+        // 다시 읽어 보니 파일이 줄었음
+        beginRemoveRows(QModelIndex(), rows, knownRows - 1);
+        knownRows = rows;
+        endRemoveRows();
+    } else if (lines > 0) {
+        emit dataChanged(this->index(int(firstLine)), this->index(int(firstLine) + lines - 1));
+    }
+
+    evictBlocks();
+}
+
+void FileViewModel::blockFailed(quint64 firstLine) {
+    pending.remove(int(firstLine / kBlockLines));
+    endKnown = true;
+}
+
+// 가장 오래 안 본 블록부터 버린다 (다시 보이면 다시 요청)
+void FileViewModel::evictBlocks() {
+    while (blocks.size() > kMaxBlocks) {
+        auto oldest = blocks.begin();
+        for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        blocks.erase(oldest);
+    }
+}
+
+int FileViewModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : knownRows;
+}
+
+QVariant FileViewModel::data(const QModelIndex& index, int role) const {
+    if (role != Qt::DisplayRole || !index.isValid()) {
+        return QVariant();
+    }
+
+    int row = index.row();
+    auto it = blocks.find(row / kBlockLines);
+    if (it == blocks.end()) {
+        requestBlock(row / kBlockLines);
+        return QString();
+    }
+    it->lastUsed = ++useClock;
+
+    // 보이는 줄만 그때그때 디코딩
+    int line = row % kBlockLines;
+    if (line >= it->lineStarts.size()) {
+        return QString();
+    }
+    int start = it->lineStarts[line];
+    int end = line + 1 < it->lineStarts.size() ? it->lineStarts[line + 1] : it->bytes.size();
+    const char* p = it->bytes.constData();
+    while (end > start && (p[end - 1] == '\n' || p[end - 1] == '\r')) {
+        end--;
+    }
+    return QString::fromUtf8(p + start, end - start);
+}
+
+bool FileViewModel::canFetchMore(const QModelIndex& parent) const {
+    return !parent.isValid() && !endKnown && !filePath.isEmpty();
+}
+
+// 맨 아래까지 스크롤하면 다음 블록
+void FileViewModel::fetchMore(const QModelIndex& parent) {
+    if (canFetchMore(parent)) {
+        requestBlock(knownRows / kBlockLines);
+    }
+}
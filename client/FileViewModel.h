@@ -0,0 +1,54 @@
+#ifndef FILE_VIEW_MODEL_H
+#define FILE_VIEW_MODEL_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// 큰 파일을 줄 단위로 보여주는 모델.
+// 서버에서 받은 줄 블록을 원본 바이트 그대로 들고 있다가 화면에 보이는 줄만 QString 으로 바꾼다.
+// 아직 받지 않은 블록이 필요해지면 rangeRequested 시그널로 요청한다.
+class FileViewModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    static constexpr int kBlockLines = 512;    // 한 번에 요청하는 줄 수
+    static constexpr int kMaxBlocks = 64;      // 메모리에 들고 있는 블록 수
+
+    explicit FileViewModel(QObject* parent = nullptr);
+
+    void open(const QString& path);
+    void reload();
+    QString path() const { return filePath; }
+    void addBlock(quint64 firstLine, const QByteArray& bytes, quint64 totalLines);
+    void blockFailed(quint64 firstLine);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+signals:
+    void rangeRequested(quint64 firstLine, int count);
+
+private:
+    struct Block {
+        QByteArray bytes;               // 줄 kBlockLines 개의 원본 바이트
+        QVector<quint32> lineStarts;    // bytes 안에서 각 줄의 시작 위치
+        quint64 lastUsed = 0;
+    };
+
+    QString filePath;
+    mutable QHash<int, Block> blocks;
+    mutable QSet<int> pending;          // 요청했지만 아직 오지 않은 블록
+    mutable quint64 useClock = 0;
+    int knownRows = 0;                  // 뷰에 알려준 줄 수
+    bool endKnown = false;              // 파일 끝을 확인했는지
+
+    void requestBlock(int block) const;
+    void evictBlocks();
+};
+
+#endif // FILE_VIEW_MODEL_H
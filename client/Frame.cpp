@@ -0,0 +1,59 @@
+#include "Frame.h"
+#include <QtEndian>
+
+static const quint8 FRAME_MAGIC = 0x4D;
+static const quint8 FRAME_VERSION = 1;
+static const int FRAME_HDR_SIZE = 12;
+static const quint32 FRAME_MAX_PAYLOAD = 16 * 1024 * 1024;
+
+QByteArray encodeFrame(quint8 type, quint32 id, const QByteArray& payload) {
+    QByteArray frame(FRAME_HDR_SIZE, Qt::Uninitialized);
+    uchar* hdr = reinterpret_cast<uchar*>(frame.data());
+
+    hdr[0] = FRAME_MAGIC;
+    hdr[1] = FRAME_VERSION;
+    hdr[2] = type;
+    hdr[3] = 0;
+    qToBigEndian<quint32>(id, hdr + 4);
+    qToBigEndian<quint32>(payload.size(), hdr + 8);
+
+    frame.append(payload);
+    return frame;
+}
+
+void FrameDecoder::feed(const QByteArray& data) {
+    // 이미 처리한 앞부분은 버퍼가 커지기 전에 정리
+    if (offset > 0 && offset >= buffer.size() / 2) {
+        buffer.remove(0, offset);
+        offset = 0;
+    }
+    buffer.append(data);
+}
+
+bool FrameDecoder::next(Frame& frame) {
+    if (error || buffer.size() - offset < FRAME_HDR_SIZE) {
+        return false;
+    }
+
+    const uchar* hdr = reinterpret_cast<const uchar*>(buffer.constData() + offset);
+    if (hdr[0] != FRAME_MAGIC || hdr[1] != FRAME_VERSION) {
+        error = true;
+        return false;
+    }
+
+    quint32 length = qFromBigEndian<quint32>(hdr + 8);
+    if (length > FRAME_MAX_PAYLOAD) {
+        error = true;
+        return false;
+    }
+    if (quint32(buffer.size() - offset - FRAME_HDR_SIZE) < length) {
+        return false;
+    }
+
+    frame.type = hdr[2];
+    frame.flags = hdr[3];
+    frame.id = qFromBigEndian<quint32>(hdr + 4);
+    frame.payload = buffer.mid(offset + FRAME_HDR_SIZE, length);
+    offset += FRAME_HDR_SIZE + length;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// 서버와 주고받는 프레임 형식 (server/frame.h 와 동일)
+//   magic(1) version(1) type(1) flags(1) request id(4) length(4) payload(length)
+namespace FrameType {
+    enum : quint8 {
+        Request     = 0x01,
+
+        Path        = 0x10,
+        Listing     = 0x11,
+        FileInfo    = 0x12,
+        File        = 0x13,
+        Procs       = 0x14,
+        Names       = 0x15,
+        Window      = 0x16,     // 정렬된 목록의 구간 정보 (offset, count, total)
+        Delta       = 0x17,     // 현재 디렉토리 변경분 ("+ 행", "~ 행", "- 이름")
+        Version     = 0x18,     // 디렉토리 목록 버전 (이전 버전, 새 버전)
+        Notify      = 0x19,     // 감시 중인 대상이 바뀜 (Notify* 비트)
+        Records     = 0x1A,     // Listing 의 바이너리 형식 (little-endian 레코드 + 문자열 테이블)
+        Job         = 0x1B,     // 백그라운드 작업 상태 (cp, rm -r, exec). 진행 상황은 id 0 응답으로 옴
+        Trash       = 0x1C,     // 휴지통 항목 ("id 지운시각 원래경로" 한 줄씩, rm -t / trash)
+        Stats       = 0x1D,     // 서버 통계 ("이름 값" 한 줄씩, cache)
+        Error       = 0x1E,
+        End         = 0x1F,
+    };
+}
+
+// Notify 프레임 payload 비트 (server/watch.h 와 동일)
+namespace Notify {
+    enum : quint8 {
+        Rescan  = 0x01,         // 디렉토리 변경분을 "ls since" 로 받아야 함
+        File    = 0x02,         // 뷰어에 열린 파일이 바뀜
+    };
+}
+
+// Records 프레임의 레코드 크기 (server/frame.h FRAME_RECORD_SIZE)
+constexpr int kRecordSize = 48;
+
+// Job 프레임의 고정 헤더 크기 (server/frame.h FRAME_JOB_SIZE), 뒤에 명령 문자열
+constexpr int kJobHeaderSize = 64;
+
+struct Frame {
+    quint8 type = 0;
+    quint8 flags = 0;
+    quint32 id = 0;
+    QByteArray payload;
+};
+
+QByteArray encodeFrame(quint8 type, quint32 id, const QByteArray& payload);
+
+// 소켓에서 읽은 바이트를 이어 붙이며 완성된 프레임을 꺼내는 디코더
+class FrameDecoder {
+public:
+    void feed(const QByteArray& data);
+    bool next(Frame& frame);
+    bool hasError() const { return error; }
+
+private:
+    QByteArray buffer;
+    int offset = 0;
+    bool error = false;
+};
+
+#endif // FRAME_H
@@ -0,0 +1,86 @@
+#ifndef JOB_STATUS_H
+#define JOB_STATUS_H
+
+#include <QString>
+#include <QtEndian>
+#include "Frame.h"
+
+// 서버의 백그라운드 작업 (cp, rm -r, exec) 하나의 상태. Job 프레임 하나에서 읽는다
+struct JobStatus {
+    enum State : quint8 { Running = 0, Done = 1, Cancelled = 2 };
+
+    quint32 id = 0;
+    quint8 state = Running;
+    qint32 status = 0;          // 끝났을 때의 반환 값 (exec 는 종료 코드)
+    quint32 elapsedMs = 0;
+    quint64 filesDone = 0;
+    quint64 filesTotal = 0;     // 0 이면 아직 모름
+    quint64 bytesDone = 0;
+    quint64 bytesTotal = 0;
+    quint64 rate = 0;           // 초당 바이트
+    quint32 eta = 0;            // 남은 초 (0xFFFFFFFF 이면 모름)
+    QString description;
+
+    bool running() const { return state == Running; }
+
+    // 이어 붙은 Job 프레임에서 하나를 꺼낸다 (jobs 응답에는 여러 개)
+    static bool next(const char*& p, const char* end, JobStatus& job) {
+        if (end - p < kJobHeaderSize) {
+            return false;
+        }
+        const uchar* h = reinterpret_cast<const uchar*>(p);
+        quint32 descLen = qFromBigEndian<quint32>(h + 60);
+        if (quint64(end - p - kJobHeaderSize) < descLen) {
+            return false;
+        }
+        job.id = qFromBigEndian<quint32>(h);
+        job.state = h[4];
+        job.status = qFromBigEndian<qint32>(h + 8);
+        job.elapsedMs = qFromBigEndian<quint32>(h + 12);
+        job.filesDone = qFromBigEndian<quint64>(h + 16);
+        job.filesTotal = qFromBigEndian<quint64>(h + 24);
+        job.bytesDone = qFromBigEndian<quint64>(h + 32);
+        job.bytesTotal = qFromBigEndian<quint64>(h + 40);
+        job.rate = qFromBigEndian<quint64>(h + 48);
+        job.eta = qFromBigEndian<quint32>(h + 56);
+        job.description = QString::fromUtf8(p + kJobHeaderSize, int(descLen));
+        p += kJobHeaderSize + descLen;
+        return true;
+    }
+
+    static QString formatBytes(quint64 bytes) {
+        const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+        double value = double(bytes);
+        int unit = 0;
+        while (value >= 1024 && unit < 4) {
+            value /= 1024;
+            unit++;
+        }
+        return QString("%1 %2").arg(value, 0, 'f', unit == 0 ? 0 : 1).arg(units[unit]);
+    }
+
+    // 한 줄 요약: "[3] cp -r a b  45%  120.0 MB/s  ETA 12s"
+    QString summary() const {
+        QString text = QString("[%1] %2  ").arg(id).arg(description);
+        if (state == Cancelled) {
+            return text + "cancelled";
+        }
+        if (state == Done) {
+            return text + (status == 0 ? QString("done") : QString("failed (%1)").arg(status));
+        }
+        if (bytesTotal > 0) {
+            text += QString("%1%  ").arg(bytesDone * 100 / bytesTotal);
+        } else if (filesTotal > 0) {
+            text += QString("%1/%2 files  ").arg(filesDone).arg(filesTotal);
+        } else if (filesDone > 0) {
+            text += QString("%1 files  ").arg(filesDone);     // rm -r 처럼 전체를 미리 세지 않는 작업
+        }
+        if (rate > 0) {
+            text += formatBytes(rate) + "/s  ";
+        }
+        text += eta == 0xFFFFFFFFu ? QString("running %1s").arg(elapsedMs / 1000) : QString("ETA %1s").arg(eta);
+        return text;
+    }
+};
+
+#endif // JOB_STATUS_H
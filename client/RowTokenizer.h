@@ -0,0 +1,64 @@
+#ifndef ROW_TOKENIZER_H
+#define ROW_TOKENIZER_H
+
+#include <QLatin1String>
+#include <QtGlobal>
+#include <cstring>
+
+// 서버가 보내는 텍스트 행 (목록, 변경분, 프로세스) 을 받은 버퍼 안에서 바로 자르는 토크나이저.
+// 필드는 원본을 가리키는 QLatin1String 이라 행이나 필드마다 할당이 없다.
+// 공백이 여러 개 이어져도 구분자 하나로 본다
+class RowTokenizer {
+public:
+    RowTokenizer(const char* begin, const char* end) : p(begin), end(end) {}
+
+    // 버퍼에서 다음 줄 [line, lineEnd) 를 꺼낸다 (개행 제외)
+    static bool nextLine(const char*& p, const char* end, const char*& line, const char*& lineEnd) {
+        if (p >= end) {
+            return false;
+        }
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        line = p;
+        lineEnd = nl ? nl : end;
+        p = lineEnd + 1;
+        return true;
+    }
+
+    bool next(QLatin1String& field) {
+        while (p < end && *p == ' ') p++;
+        const char* start = p;
+        while (p < end && *p != ' ') p++;
+        field = QLatin1String(start, int(p - start));
+        return p > start;
+    }
+
+    // 구분 공백 하나를 건너뛴 나머지 (공백이 들어갈 수 있는 마지막 필드)
+    const char* rest() const { return p < end && *p == ' ' ? p + 1 : p; }
+
+    static bool toUInt64(QLatin1String field, quint64& value) {
+        value = 0;
+        for (const char* c = field.data(); c < field.data() + field.size(); c++) {
+            if (*c < '0' || *c > '9') {
+                return false;
+            }
+            value = value * 10 + quint64(*c - '0');
+        }
+        return field.size() > 0;
+    }
+
+    static bool toInt64(QLatin1String field, qint64& value) {
+        bool negative = field.size() > 0 && field.data()[0] == '-';
+        quint64 magnitude;
+        if (!toUInt64(negative ? QLatin1String(field.data() + 1, field.size() - 1) : field, magnitude)) {
+            return false;
+        }
+        value = negative ? -qint64(magnitude) : qint64(magnitude);
+        return true;
+    }
+
+private:
+    const char* p;
+    const char* end;
+};
+
+#endif // ROW_TOKENIZER_H
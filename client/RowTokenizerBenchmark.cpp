@@ -0,0 +1,85 @@
+#include <QtTest>
+#include <QRegExp>
+#include "RowTokenizer.h"
+
+static const int BENCH_ROWS = 100000;
+
+// 서버 텍스트 목록 행을 예전 방식 (QString + QRegExp split) 과 RowTokenizer 로 각각 자르는 시간 비교
+class RowTokenizerBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void regExpSplit();
+    void rowTokenizer();
+
+private:
+    // 행마다 size 필드를 더한 값 (두 방식이 같은 결과를 내는지 확인용)
+    static quint64 sumRegExp(const QByteArray& data);
+    static quint64 sumTokenizer(const QByteArray& data);
+
+    QByteArray listing;
+    quint64 expected = 0;
+};
+
+void RowTokenizerBenchmark::initTestCase() {
+    // "ino 권한 타입 uid gid atime mtime ctime nlink size 이름"
+    listing.reserve(BENCH_ROWS * 96);
+    for (int i = 0; i < BENCH_ROWS; i++) {
+        quint64 size = quint64(i) * 37 % 1000003;
+        listing += QByteArray::number(1000000 + i) + " -rw-r--r-- REG 1000 1000 1700000000 1700000000 1700000000 1 " +
+                   QByteArray::number(size) + " file_" + QByteArray::number(i) + ".txt\n";
+        expected += size;
+    }
+}
+
+quint64 RowTokenizerBenchmark::sumRegExp(const QByteArray& data) {
+    quint64 sum = 0;
+    QStringList lines = QString(data).split('\n', Qt::SkipEmptyParts);
+    for (const QString& line : lines) {
+        QStringList fields = line.split(QRegExp("\\s+"), Qt::SkipEmptyParts);
+        if (fields.size() >= 11) {
+            sum += fields[9].toULongLong();
+        }
+    }
+    return sum;
+}
+
+quint64 RowTokenizerBenchmark::sumTokenizer(const QByteArray& data) {
+    quint64 sum = 0;
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    const char *line, *lineEnd;
+    while (RowTokenizer::nextLine(p, end, line, lineEnd)) {
+        RowTokenizer row(line, lineEnd);
+        QLatin1String field;
+        quint64 size;
+        int i = 0;
+        while (i < 10 && row.next(field)) {
+            i++;
+        }
+        if (i == 10 && RowTokenizer::toUInt64(field, size)) {
+            sum += size;
+        }
+    }
+    return sum;
+}
+
+void RowTokenizerBenchmark::regExpSplit() {
+    quint64 sum = 0;
+    QBENCHMARK {
+        sum = sumRegExp(listing);
+    }
+    QCOMPARE(sum, expected);
+}
+
+void RowTokenizerBenchmark::rowTokenizer() {
+    quint64 sum = 0;
+    QBENCHMARK {
+        sum = sumTokenizer(listing);
+    }
+    QCOMPARE(sum, expected);
+}
+
+QTEST_APPLESS_MAIN(RowTokenizerBenchmark)
+#include "RowTokenizerBenchmark.moc"
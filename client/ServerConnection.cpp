@@ -0,0 +1,70 @@
+#include "ServerConnection.h"
+#include <QDebug>
+#include <QtEndian>
+
+ServerConnection::ServerConnection(QObject* parent) : QObject(parent) {
+    socket = new QTcpSocket(this);
+
+    connect(socket, &QTcpSocket::connected, this, &ServerConnection::onConnected);
+    connect(socket, &QTcpSocket::readyRead, this, &ServerConnection::onReadyRead);
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this, [this]() {
+        qDebug() << "Server connection error:" << socket->errorString();
+        emit connectionError(socket->errorString());
+    });
+}
+
+void ServerConnection::connectToServer(const QHostAddress& address, quint16 port) {
+    socket->connectToHost(address, port);
+}
+
+quint32 ServerConnection::request(const QString& command) {
+    quint32 id = nextRequestId++;
+    QByteArray frame = encodeFrame(FrameType::Request, id, command.trimmed().toUtf8());
+
+    // 연결 전이면 모아 두었다가 연결되면 한 번에 전송
+    if (socket->state() == QAbstractSocket::ConnectedState) {
+        socket->write(frame);
+    } else {
+        unsent.append(frame);
+    }
+
+    inFlight++;
+    qDebug() << "Request" << id << ":" << command.trimmed();
+    return id;
+}
+
+void ServerConnection::onConnected() {
+    qDebug() << "Connected to server.";
+    if (!unsent.isEmpty()) {
+        socket->write(unsent);
+        unsent.clear();
+    }
+}
+
+void ServerConnection::onReadyRead() {
+    decoder.feed(socket->readAll());  // 서버로부터 응답 읽기
+
+    Frame frame;
+    while (decoder.next(frame)) {
+        ServerReply& reply = replies[frame.id];
+
+        if (frame.type != FrameType::End) {
+            // 같은 타입의 프레임은 이어 붙여서 하나의 응답으로 처리
+            reply.parts[frame.type].append(frame.payload);
+            continue;
+        }
+
+        if (frame.payload.size() >= 4) {
+            reply.status = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(frame.payload.constData()));
+        }
+        if (frame.id != 0) {
+            inFlight--;
+        }
+        emit replyReceived(frame.id, replies.take(frame.id));
+    }
+
+    if (decoder.hasError()) {
+        qDebug() << "Invalid frame from server, disconnecting.";
+        socket->abort();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef SERVER_CONNECTION_H
+#define SERVER_CONNECTION_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QHash>
+#include "Frame.h"
+
+// 요청 하나에 대한 응답 (FT_END 를 받으면 완성)
+struct ServerReply {
+    QHash<quint8, QByteArray> parts;   // 프레임 타입별로 이어 붙인 payload
+    qint32 status = 0;                 // 서버 명령어 반환 값
+
+    bool has(quint8 type) const { return parts.contains(type); }
+    QByteArray part(quint8 type) const { return parts.value(type); }
+};
+
+// 서버와의 비동기 요청 계층.
+// 요청마다 id 를 붙여 바로 전송하고 (여러 개를 동시에 보낼 수 있음),
+// 응답이 완성되면 replyReceived 시그널로 돌려준다. 어디서도 블로킹하지 않는다.
+// 서버가 요청 없이 보내는 알림은 id 0 인 응답으로 온다.
+class ServerConnection : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ServerConnection(QObject* parent = nullptr);
+
+    void connectToServer(const QHostAddress& address, quint16 port);
+    quint32 request(const QString& command);
+    int pendingCount() const { return inFlight; }
+
+signals:
+    void replyReceived(quint32 id, const ServerReply& reply);
+    void connectionError(const QString& message);
+
+private:
+    QTcpSocket* socket;
+    FrameDecoder decoder;
+    QHash<quint32, ServerReply> replies;
+    QByteArray unsent;                 // 연결되기 전에 보낸 요청
+    quint32 nextRequestId = 1;
+    int inFlight = 0;
+
+    void onConnected();
+    void onReadyRead();
+};
+
+#endif // SERVER_CONNECTION_H
@@ -13,6 +13,10 @@
 #include <QDebug>
 #include <QPushButton>
 #include <QDateTime>
+#include <QHeaderView>
+#include <QFontMetrics>
+#include <QtEndian>
+#include "RowTokenizer.h"
 
 TextStyleFileExplorer::TextStyleFileExplorer(QWidget* parent) : QWidget(parent) {
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
@@ -29,17 +33,64 @@ TextStyleFileExplorer::TextStyleFileExplorer(QWidget* parent) : QWidget(parent)
     pathLayout->addWidget(currentPathLabel);
     mainLayout->addLayout(pathLayout);
 
-    // 파일 리스트
-    fileList = new QListWidget(this);
-    fileList->setFocusPolicy(Qt::StrongFocus);
-
-    QPalette palette = fileList->palette();
+    // 파일 리스트: 행은 모델이 들고 있고 뷰는 보이는 행만 그린다
+    dirModel = new DirectoryModel(this);
+    dirView = new QTableView(this);
+    dirView->setModel(dirModel);
+    dirView->setFocusPolicy(Qt::StrongFocus);
+    dirView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    dirView->setSelectionMode(QAbstractItemView::SingleSelection);
+    dirView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    dirView->setShowGrid(false);
+    dirView->setWordWrap(false);
+    dirView->verticalHeader()->hide();
+    dirView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed); // 행 높이 고정
+    dirView->horizontalHeader()->setStretchLastSection(true);
+
+    QPalette palette = dirView->palette();
     palette.setColor(QPalette::Base, Qt::black);
     palette.setColor(QPalette::Text, Qt::white);
+    dirView->setPalette(palette);
+
+    // 프로세스 목록처럼 텍스트로 보여주는 결과
+    fileList = new QListWidget(this);
+    fileList->setFocusPolicy(Qt::StrongFocus);
     fileList->setPalette(palette);
+    fileList->hide();
+
+    // 파일 내용 보기: 보이는 줄만 그리도록 모델/뷰로 구성
+    fileModel = new FileViewModel(this);
+    fileView = new QListView(this);
+    fileView->setModel(fileModel);
+    fileView->setUniformItemSizes(true);
+    fileView->setPalette(palette);
+    fileView->hide();
+
+    // 이름, 권한 등을 입력받는 줄 (필요할 때만 표시)
+    commandInput = new QLineEdit(this);
+    commandInput->hide();
+    connect(commandInput, &QLineEdit::returnPressed, this, [this]() {
+        QString text = commandInput->text().trimmed();
+        auto onDone = promptCallback;
+        promptCallback = nullptr;
+        commandInput->hide();
+        dirView->setFocus();
+        if (onDone && !text.isEmpty()) {
+            onDone(text);
+        }
+    });
 
     mainLayout->addWidget(currentPathLabel);
+    mainLayout->addWidget(dirView);
     mainLayout->addWidget(fileList);
+    mainLayout->addWidget(fileView);
+    mainLayout->addWidget(commandInput);
+
+    // 백그라운드 작업 상태 줄 (작업이 있을 때만 표시)
+    jobLabel = new QLabel(this);
+    jobLabel->setStyleSheet("font-size: 12px;");
+    jobLabel->hide();
+    mainLayout->addWidget(jobLabel);
 
     // 명령어 박스 추가
     QFrame* commandBox = new QFrame(this);
@@ -58,8 +109,10 @@ TextStyleFileExplorer::TextStyleFileExplorer(QWidget* parent) : QWidget(parent)
     commandDetails->setText(
         "[Ctrl+C: Copy]    [Ctrl+V: Paste]    [F1: Create Folder]    [F2: Create File]\n"
         "[F3: Change Permission]    [F4: Run Process]    [F5: Show Process List]\n"
-        "[F6: Soft Link]    [F7: Hard Link]    [Del: Delete]    [Home: Go to Root]\n"
-        "[ESC: Refresh Directory]    [End: Kill Process]    [Enter: Change Directory or Open File]" 
+        "[F6: Soft Link]    [F7: Hard Link]    [Home: Go to Root]    [End: Kill Process]\n"
+        "[ESC: Refresh Directory]    [Enter: Change Directory or Open File]\n"
+        "[Del: Move to Trash]    [Shift+Del: Delete]    [Ctrl+Z: Restore]    [F10: Show Trash]\n"
+        "[F8: Cancel Job]    [F9: Show Jobs]"
     );
 
     commandBoxLayout->addWidget(commandTitle);
@@ -68,43 +121,71 @@ TextStyleFileExplorer::TextStyleFileExplorer(QWidget* parent) : QWidget(parent)
 
     // 기본 창 설정
     setWindowTitle("Text-Style File Explorer");
-    setFixedSize(620, 500); // 명령어 박스 추가로 창 크기 조정
+    setFixedSize(620, 560); // 명령어 박스, 작업 상태 줄 추가로 창 크기 조정
 
     // 이벤트 필터 설정
+    dirView->installEventFilter(this);
     fileList->installEventFilter(this);
+    fileView->installEventFilter(this);
+    commandInput->installEventFilter(this);
 
-    // TCP 소켓 설정
-    socket = new QTcpSocket(this);
-    socket->connectToHost(QHostAddress("127.0.0.1"), 8080);
-    connect(socket, &QTcpSocket::readyRead, this, &TextStyleFileExplorer::onServerResponse);
+    // 서버 연결 설정 (연결 완료를 기다리지 않음)
+    connection = new ServerConnection(this);
+    connect(connection, &ServerConnection::replyReceived, this, &TextStyleFileExplorer::handleReply);
 
-    if (!socket->waitForConnected(3000)) {
-        qDebug() << "Failed to connect to server:" << socket->errorString();
-    } else {
-        qDebug() << "Connected to server.";
-    }
+    // 목록 끝까지 스크롤하면 다음 페이지 요청
+    connect(dirModel, &DirectoryModel::pageRequested, this, [this](int offset) {
+        requestListing(offset, kListingPageSize);
+    });
+
+    // 뷰어가 아직 받지 않은 줄을 보여줘야 할 때 해당 구간만 요청
+    connect(fileModel, &FileViewModel::rangeRequested, this, [this](quint64 firstLine, int count) {
+        QString command = QString("cat -l %1 %2 %3").arg(firstLine).arg(count).arg(fileModel->path());
+        fileRequests.insert(connection->request(command), firstLine);
+    });
+    connection->connectToServer(QHostAddress("127.0.0.1"), 8080);
 }
 
 void TextStyleFileExplorer::init() {
     QFont fixedFont("Courier New"); // 고정 폭 글꼴 지정
     fixedFont.setStyleHint(QFont::TypeWriter); // 고정 폭 힌트 설정
     fileList->setFont(fixedFont); // QListWidget에 글꼴 적용
+    fileView->setFont(fixedFont);
+    dirView->setFont(fixedFont);
+    dirView->verticalHeader()->setDefaultSectionSize(QFontMetrics(fixedFont).height() + 4);
+    dirView->setColumnWidth(DirectoryModel::Permissions, 110);
+    dirView->setColumnWidth(DirectoryModel::Type, 50);
+    dirView->setColumnWidth(DirectoryModel::Modified, 150);
+    dirView->setColumnWidth(DirectoryModel::Size, 80);
+
+    // 목록은 바이너리 레코드로 받는다 (변경분은 텍스트). 요청은 보낸 순서대로 처리된다
+    connection->request("format binary");
+
+    // 루트로 이동하면서 목록 첫 페이지까지 한 번에 받기
+    connection->request(QString("go / %1 name").arg(kListingPageSize));
+}
 
-    if (socket->write("cd /") == -1) {
-        qDebug() << "Failed to send cd command:" << socket->errorString();
-    } else if (!socket->waitForReadyRead(3000)) {
-        qDebug() << "Timeout while sending ls command.";
+bool TextStyleFileExplorer::eventFilter(QObject* obj, QEvent* event) {
+    if (obj == fileView && event->type() == QEvent::KeyPress) {
+        if (static_cast<QKeyEvent*>(event)->key() == Qt::Key_Escape) {
+            closeFileViewer();
+            return true;
+        }
+        return QWidget::eventFilter(obj, event); // 스크롤 키는 뷰가 처리
     }
-    if (socket->write("ls") == -1) {
-        qDebug() << "Failed to send ls command:" << socket->errorString();
-    } else if (!socket->waitForReadyRead(3000)) {
-        qDebug() << "Timeout while sending ls command.";
+
+    if (obj == commandInput && event->type() == QEvent::KeyPress) {
+        if (static_cast<QKeyEvent*>(event)->key() == Qt::Key_Escape) {
+            // 입력 취소
+            promptCallback = nullptr;
+            commandInput->hide();
+            dirView->setFocus();
+            return true;
+        }
+        return QWidget::eventFilter(obj, event);
     }
-    qDebug() << "Sent to server: pwd";
-}
 
-bool TextStyleFileExplorer::eventFilter(QObject* obj, QEvent* event) {
-    if (obj == fileList && event->type() == QEvent::KeyPress) {
+    if ((obj == dirView || obj == fileList) && event->type() == QEvent::KeyPress) {
         QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
 
         if (keyEvent->matches(QKeySequence::Copy)) { // Ctrl+C
@@ -113,17 +194,23 @@ bool TextStyleFileExplorer::eventFilter(QObject* obj, QEvent* event) {
         } else if (keyEvent->matches(QKeySequence::Paste)) { // Ctrl+V
             handlePaste();
             return true;
-        } else if (keyEvent->key() == Qt::Key_Up) {
+        } else if (keyEvent->matches(QKeySequence::Undo)) { // Ctrl+Z: 휴지통에서 복구
+            handleRestore();
+            return true;
+        } else if (obj == fileList && keyEvent->key() == Qt::Key_Up) {
             moveSelection(-1);
             return true;
-        } else if (keyEvent->key() == Qt::Key_Down) {
+        } else if (obj == fileList && keyEvent->key() == Qt::Key_Down) {
             moveSelection(1);
             return true;
         } else if (keyEvent->key() == Qt::Key_Return) {
             handleEnter();
             return true;
+        } else if (keyEvent->key() == Qt::Key_Delete && (keyEvent->modifiers() & Qt::ShiftModifier)) {
+            handleDeletePermanently(); // rm, rm -r
+            return true;
         } else if (keyEvent->key() == Qt::Key_Delete) {
-            handleDelete(); // rm
+            handleDelete(); // rm -t
             return true;
         } else if (keyEvent->key() == Qt::Key_F1) {
             handleCreateFolder(); // mkdir
@@ -132,7 +219,8 @@ bool TextStyleFileExplorer::eventFilter(QObject* obj, QEvent* event) {
             handleCreateFile(); // touch
             return true;
         } else if (keyEvent->key() == Qt::Key_Escape) { // ESC 키 처리
-            handleRefreshDirectory(); // ls 명령 실행
+            showView(dirView);
+            syncDirectory(); // 목록을 받은 뒤의 변경분만 요청
             return true;
         } else if (keyEvent->key() == Qt::Key_F5) {
             handleShowProcessList(); // ps
@@ -155,6 +243,15 @@ bool TextStyleFileExplorer::eventFilter(QObject* obj, QEvent* event) {
         } else if (keyEvent->key() == Qt::Key_Home) { // Home 키 처리
             handleGoToRootDirectory();
             return true;
+        } else if (keyEvent->key() == Qt::Key_F8) { // 마지막 작업 취소
+            handleCancelJob();
+            return true;
+        } else if (keyEvent->key() == Qt::Key_F9) { // 작업 목록
+            handleShowJobs();
+            return true;
+        } else if (keyEvent->key() == Qt::Key_F10) { // 휴지통 목록
+            handleShowTrash();
+            return true;
         }
     } 
     return QWidget::eventFilter(obj, event);
@@ -168,327 +265,425 @@ void TextStyleFileExplorer::moveSelection(int step) {
     }
 }
 
+void TextStyleFileExplorer::requestListing(int offset, int count) {
+    // 서버가 폴더 우선 + 이름순으로 정렬해서 [offset, offset + count) 만 보내준다
+    connection->request(QString("ls -w %1 %2 name").arg(offset).arg(count));
+}
+
+// 디렉토리 목록, 텍스트 출력, 파일 뷰어 중 하나만 보여준다
+void TextStyleFileExplorer::showView(QWidget* view) {
+    for (QWidget* w : { static_cast<QWidget*>(dirView), static_cast<QWidget*>(fileList),
+                        static_cast<QWidget*>(fileView) }) {
+        w->setVisible(w == view);
+    }
+    view->setFocus();
+}
+
+const DirEntry* TextStyleFileExplorer::selectedEntry() const {
+    if (!dirView->isVisible()) {
+        return nullptr;
+    }
+    return dirModel->entry(dirView->currentIndex().row());
+}
+
+// 입력 줄을 보여주고 Enter 를 누르면 onDone 을 부른다 (ESC 는 취소)
+void TextStyleFileExplorer::promptInput(const QString& placeholder, std::function<void(const QString&)> onDone) {
+    promptCallback = onDone;
+    commandInput->clear();
+    commandInput->setPlaceholderText(placeholder);
+    commandInput->show();
+    commandInput->setFocus();
+}
+
+
 void TextStyleFileExplorer::handleEnter() {
-    QString selectedItem = fileList->currentItem() ? fileList->currentItem()->text() : "";
+    const DirEntry* entry = selectedEntry();
 
-    if (selectedItem.isEmpty()) {
+    if (entry == nullptr) {
         return;
     }
 
-    // 선택된 항목에서 파일/폴더 이름 추출
-    QString folderName = selectedItem.section(' ', -1); // 마지막 항목이 파일/폴더 이름
-    folderName.remove('\"');
+    if (entry->isDir()) { // 폴더인지 확인
+        // 디렉토리 이동과 목록 첫 페이지 요청을 한 번에 (경로 + 목록이 한 응답으로 옴)
+        connection->request(QString("go %1 %2 name").arg(entry->name).arg(kListingPageSize));
+    } else {
+        // 파일 내용은 뷰어가 보이는 구간만 줄 단위로 요청
+        QString path = currentPathLabel->text() == "/" ? "/" + entry->name
+                                                        : currentPathLabel->text() + "/" + entry->name;
+        openFileViewer(path);
+    }
+}
 
-    if (selectedItem.contains("DIR")) { // 폴더인지 확인
-        // cd 명령 전송
-        QString command = "cd " + folderName;
-        if (socket->write(command.toUtf8()) == -1) {
-            qDebug() << "Failed to send cd command:" << socket->errorString();
-            return;
-        } else if (!socket->waitForReadyRead(3000)) {
-            qDebug() << "Timeout while sending ls command.";
-        }
-        qDebug() << "Sent to server: cd" << folderName;
+void TextStyleFileExplorer::openFileViewer(const QString& path) {
+    fileRequests.clear(); // 이전 파일의 응답은 무시
+    connection->request("watch " + path); // 보는 동안 바뀌면 알림
+    fileModel->open(path);
+    showView(fileView);
+}
 
-        if (socket->write("ls") == -1) {
-            qDebug() << "Failed to send ls command:" << socket->errorString();
-        } else if (!socket->waitForReadyRead(3000)) {
-            qDebug() << "Timeout while sending ls command.";
-        }
-    } else {
-        QString command = "cat " + folderName; // 파일 내용 읽기 명령 (cat 사용)
-        qDebug() << "Sending to server: " << command;
-        if (socket->write(command.toUtf8()) == -1) {
-            qDebug() << "Failed to send file read command:" << socket->errorString();
-            return;
-        } else if (!socket->waitForReadyRead(3000)) {
-            qDebug() << "Timeout while sending cat command.";
+void TextStyleFileExplorer::closeFileViewer() {
+    connection->request("watch");
+    showView(dirView);
+    syncDirectory();
+}
+
+void TextStyleFileExplorer::handleFileBlock(quint64 requestedLine, const ServerReply& reply) {
+    QByteArray info = reply.part(FrameType::FileInfo);
+
+    if (reply.status != 0 || info.size() < 32) {
+        qDebug() << "Line range read failed for" << fileModel->path() << "from line" << requestedLine;
+        fileModel->blockFailed(requestedLine);
+        if (requestedLine == 0 && reply.status != 0) {
+            // 줄 단위로 읽을 수 없는 파일 (파이프 등) 은 통째로 받아서 보여준다
+            showView(fileList);
+            connection->request("cat " + fileModel->path());
         }
+        return;
     }
+
+    // 파일 크기, 구간 시작, 첫 줄 번호, 전체 줄 수
+    const char* header = info.constData();
+    quint64 firstLine = qFromBigEndian<quint64>(header + 16);
+    quint64 totalLines = qFromBigEndian<quint64>(header + 24);
+    fileModel->addBlock(firstLine, reply.part(FrameType::File), totalLines);
 }
 
-void TextStyleFileExplorer::onServerResponse() {
-    QByteArray response = socket->readAll();  // 서버로부터 응답 읽기
-    qDebug() << "Received from server:" << QString(response);
+void TextStyleFileExplorer::handleReply(quint32 id, const ServerReply& reply) {
+    qDebug() << "Received reply" << id << "status" << reply.status;
+
+    if (fileRequests.contains(id)) {
+        handleFileBlock(fileRequests.take(id), reply);
+        return;
+    }
+    if (syncRequest != 0 && id == syncRequest) {
+        syncRequest = 0;
+        if (reply.status != 0) {
+            // 서버 스냅샷이 없거나 버전이 다르면 처음부터 다시 받는다
+            handleRefreshDirectory();
+            return;
+        }
+    }
 
-    if (response.startsWith("/")) {
-        // pwd 명령 결과로 간주하고 currentPathLabel 업데이트
-        QString currentPath = QString(response).trimmed(); // 개행 및 공백 제거
+    if (reply.has(FrameType::Error)) {
+        qDebug() << "Server error:" << QString::fromUtf8(reply.part(FrameType::Error));
+    }
+    if (reply.has(FrameType::Path)) {
+        // cd 명령 결과로 currentPathLabel 업데이트
+        QString currentPath = QString::fromUtf8(reply.part(FrameType::Path));
         currentPathLabel->setText(currentPath);
         qDebug() << "Updated current path:" << currentPath;
-    } else if (response.startsWith("FILE_CONTENT_START:")) {
-        QString fileName = QString(response).section(':', 1, 1).trimmed();
-        qDebug() << "Receiving content for file:" << fileName;
-
-        // Extract and process file content
-        QString fileContent = QString(response).section('\n', 1).trimmed();
-        qDebug() << "File content:" << fileContent;
-
-        fileList->clear();
-        QStringList fileLines = QString(fileContent).split('\n', Qt::SkipEmptyParts);
-        for (const QString& line : fileLines) {
-            fileList->addItem(QString(line));
+    }
+    if (reply.has(FrameType::FileInfo)) {
+        // 파일 정보: 파일 크기, 구간 시작, 첫 줄 번호, 전체 줄 수 (uint64) + 경로
+        QByteArray info = reply.part(FrameType::FileInfo);
+        QByteArray content = reply.part(FrameType::File);
+        if (info.size() >= 32) {
+            quint64 size = qFromBigEndian<quint64>(info.constData());
+            if (size != quint64(-1) && size != quint64(content.size())) {
+                qDebug() << "File size mismatch:" << size << "expected," << content.size() << "received";
+            }
+            showFileContent(QString::fromUtf8(info.mid(32)), content);
+        }
+    }
+    if (reply.has(FrameType::Procs)) {
+        showProcessList(reply.part(FrameType::Procs));
+    }
+    if (reply.has(FrameType::Stats)) {
+        qDebug().noquote() << "Server stats:\n" + QString::fromUtf8(reply.part(FrameType::Stats)).trimmed();
+    }
+    if (reply.has(FrameType::Window)) {
+        bool records = reply.has(FrameType::Records);
+        showDirectoryListing(reply.part(FrameType::Window),
+                             reply.part(records ? FrameType::Records : FrameType::Listing), records);
+    }
+    if (reply.has(FrameType::Version)) {
+        applyVersion(reply.part(FrameType::Version), reply.part(FrameType::Delta));
+    }
+    if (reply.has(FrameType::Notify) && !reply.part(FrameType::Notify).isEmpty()) {
+        handleNotify(quint8(reply.part(FrameType::Notify).at(0)));
+    }
+    if (reply.has(FrameType::Job)) {
+        updateJobs(reply.part(FrameType::Job));
+        if (jobsRequest != 0 && id == jobsRequest) {
+            jobsRequest = 0;
+            showJobList(reply.part(FrameType::Job));
         }
-        fileList->addItem(QString("--- Press ESC to go back ---")); // 안내 메시지 추가
-
-        fileList->setStyleSheet("");
-        fileList->update();
-    } else if (response.startsWith("error")) {
-        ;
-    } else if (response.startsWith("PROCESS_LIST_START")) {
-        // 프로세스 목록 처리
-        QString processList = QString(response).section('\n', 1).trimmed(); // 첫 줄 이후 데이터
-        qDebug() << "Process list received:\n" << processList;
-
-        // 프로세스 목록을 fileList에 출력
-        fileList->clear();
-
-        // 헤더 추가
-        QString header = QString("%1 %2 %3")
-                            .arg("PID", -8)   // 왼쪽 정렬, 8자리
-                            .arg("PPID", -8)  // 왼쪽 정렬, 8자리
-                            .arg("CMD");
-        fileList->addItem(header);
-        fileList->addItem(QString("=").repeated(header.length())); // 구분선 추가
-
-        // 프로세스 목록 파싱 및 출력
-        QStringList processLines = processList.split('\n', Qt::SkipEmptyParts);
-        for (const QString& line : processLines) {
-            QStringList fields = line.split(QRegExp("\\s+"), Qt::SkipEmptyParts);
-            if (fields.size() >= 3) {
-                QString pid = fields[0];
-                QString ppid = fields[1];
-                QString cmd = fields.mid(2).join(" "); // 나머지 필드를 CMD로 처리
-
-                // 정렬된 포맷으로 출력
-                QString formattedLine = QString("%1 %2 %3")
-                                            .arg(pid, -8)   // PID, 왼쪽 정렬 8자리
-                                            .arg(ppid, -8)  // PPID, 왼쪽 정렬 8자리
-                                            .arg(cmd);
-                fileList->addItem(formattedLine);
+    }
+    if (reply.has(FrameType::Trash)) {
+        if (trashRequest != 0 && id == trashRequest) {
+            trashRequest = 0;
+            showTrashList(reply.part(FrameType::Trash));
+        } else {
+            // rm -t 의 응답: 옮긴 항목의 id 를 기억해 두었다가 Ctrl+Z 로 되돌린다
+            const QByteArray data = reply.part(FrameType::Trash);
+            const char* p = data.constData();
+            const char* end = p + data.size();
+            const char *line, *lineEnd;
+            while (RowTokenizer::nextLine(p, end, line, lineEnd)) {
+                RowTokenizer row(line, lineEnd);
+                QLatin1String trashId;
+                if (row.next(trashId)) {
+                    trashedIds << QString(trashId);
+                }
             }
         }
+    }
+}
 
-        // 안내 메시지 추가
-        fileList->addItem("--- Press ESC to go back ---");
+// cp, rm -r, exec 의 응답과 id 0 으로 오는 진행 상황. 실행 중인 작업만 들고 있는다
+void TextStyleFileExplorer::updateJobs(const QByteArray& data) {
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    JobStatus job;
+
+    while (JobStatus::next(p, end, job)) {
+        if (job.running()) {
+            runningJobs.insert(job.id, job);
+        } else if (runningJobs.remove(job.id) > 0) {
+            lastJobResult = job.summary();
+            qDebug() << "Job finished:" << lastJobResult;
+        }
+    }
 
-        fileList->setStyleSheet("");
-        fileList->update();
-    } else {
-        // 파일/폴더 리스트 처리
-        QStringList fileListData = QString(response).split('\n', Qt::SkipEmptyParts);
-
-        // 기존 파일 리스트 지우기
-        fileList->clear();
-
-        // 이름순 정렬을 위한 리스트 생성
-        QList<QPair<QString, QString>> sortedList;
-
-        for (const QString& entry : fileListData) {
-            QStringList fields = entry.split(QRegExp("\\s+"), Qt::SkipEmptyParts);
-            if (fields.size() >= 9) {
-                QString permissions = fields[1];          // 권한
-                QString type = fields[2];                 // 폴더/파일 구분
-                qint64 modificationTimeSec = fields[6].toLongLong(); // 수정 시간 (초 단위)
-                QString size = fields[9];                 // 파일 크기
-                QString name = fields[10];                // 파일 이름
-
-                // 초 단위를 yyyy-MM-dd hh:mm 형식으로 변환
-                QString modificationTime = QDateTime::fromSecsSinceEpoch(modificationTimeSec)
-                                            .toString("yyyy-MM-dd hh:mm");
-
-                // 폴더/파일 정보를 한 줄로 표시
-                QString displayEntry = QString("%1 %2 %3 %4 %5")
-                                        .arg(permissions, -10)
-                                        .arg(type, -5)
-                                        .arg(modificationTime, -15)
-                                        .arg(size, -8)
-                                        .arg(name);
-
-                // 이름과 디스플레이 엔트리를 페어로 추가
-                sortedList.append(qMakePair(name, displayEntry));
-            }
+    QStringList lines;
+    for (const JobStatus& running : runningJobs) {
+        lines << running.summary();
+    }
+    if (lines.isEmpty() && !lastJobResult.isEmpty()) {
+        lines << lastJobResult;
+    }
+    jobLabel->setText(lines.join('\n'));
+    jobLabel->setVisible(!lines.isEmpty());
+}
+
+void TextStyleFileExplorer::showJobList(const QByteArray& data) {
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    JobStatus job;
+
+    showView(fileList);
+    fileList->clear();
+    while (JobStatus::next(p, end, job)) {
+        fileList->addItem(job.summary());
+    }
+    fileList->addItem("--- Press ESC to go back ---");
+}
+
+// "id 지운시각 원래경로" 행. 항목에 id 를 넣어 두고 Ctrl+Z 로 선택한 것을 복구한다
+void TextStyleFileExplorer::showTrashList(const QByteArray& data) {
+    showView(fileList);
+    fileList->clear();
+    fileList->addItem(QString("%1 %2").arg("DELETED", -21).arg("PATH"));
+    fileList->addItem(QString("=").repeated(40));
+
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    const char *line, *lineEnd;
+    while (RowTokenizer::nextLine(p, end, line, lineEnd)) {
+        RowTokenizer row(line, lineEnd);
+        QLatin1String trashId, when;
+        qint64 seconds;
+        if (!row.next(trashId) || !row.next(when) || !RowTokenizer::toInt64(when, seconds)) {
+            continue;
         }
+        QString deleted = QDateTime::fromSecsSinceEpoch(seconds).toString("yyyy-MM-dd hh:mm:ss");
+        QString path = QString::fromUtf8(row.rest(), int(lineEnd - row.rest()));
+        QListWidgetItem* item = new QListWidgetItem(QString("%1 %2").arg(deleted, -21).arg(path), fileList);
+        item->setData(kTrashIdRole, QString(trashId));
+    }
+    if (fileList->count() == 2) {
+        fileList->addItem("(trash is empty)");
+    }
+    fileList->addItem("--- Ctrl+Z: restore selected, ESC: go back ---");
+}
 
-        // 이름순 정렬 (폴더 우선, 이름순 정렬)
-        std::sort(sortedList.begin(), sortedList.end(), [](const QPair<QString, QString>& a, const QPair<QString, QString>& b) {
-            // 첫 번째 요소가 DIR인지 확인
-            bool isDirA = a.second.contains("DIR");
-            bool isDirB = b.second.contains("DIR");
-
-            // 폴더는 먼저 오도록 정렬
-            if (isDirA && !isDirB) {
-                return true; // a가 폴더고 b는 폴더가 아니면 a가 먼저
-            } else if (!isDirA && isDirB) {
-                return false; // b가 폴더고 a는 폴더가 아니면 b가 먼저
-            }
+// 서버가 감시 중인 디렉토리/파일이 다른 곳에서 바뀌었다고 알려 옴.
+// 디렉토리 변경분은 보통 id 0 응답의 Delta 로 바로 오고, 너무 많으면 Rescan 만 온다
+void TextStyleFileExplorer::handleNotify(quint8 flags) {
+    if (flags & Notify::Rescan) {
+        syncDirectory();
+    }
+    if ((flags & Notify::File) && fileView->isVisible()) {
+        fileRequests.clear(); // 바뀌기 전 내용의 응답은 버린다
+        fileModel->reload();
+    }
+}
 
-            // 둘 다 폴더이거나 둘 다 파일이면 이름순으로 정렬
-            return a.first < b.first;
-        });
+// 목록 버전 (이전 버전, 새 버전). 이전 버전이 0 이면 방금 받은 전체 목록의 버전이고,
+// 아니면 가진 목록이 그 버전일 때만 변경분을 적용할 수 있다
+void TextStyleFileExplorer::applyVersion(const QByteArray& version, const QByteArray& delta) {
+    if (version.size() < 8) {
+        return;
+    }
 
-        // 정렬된 리스트를 QListWidget에 추가
-        for (const auto& pair : sortedList) {
-            fileList->addItem(pair.second); // 정렬된 항목 추가
+    const uchar* header = reinterpret_cast<const uchar*>(version.constData());
+    quint32 base = qFromBigEndian<quint32>(header);
+    quint32 next = qFromBigEndian<quint32>(header + 4);
+
+    if (base == 0) {
+        dirModel->setVersion(next);
+    } else if (base == dirModel->version()) {
+        dirModel->applyDelta(delta);
+        dirModel->setVersion(next);
+        if (!dirView->currentIndex().isValid() && dirModel->rowCount() > 0) {
+            dirView->setCurrentIndex(dirModel->index(0, 0));
         }
+    } else {
+        qDebug() << "Listing version" << dirModel->version() << "is behind" << base << ", reloading";
+        handleRefreshDirectory();
+    }
+}
 
-        fileList->setStyleSheet("");
-        fileList->update();
+void TextStyleFileExplorer::showFileContent(const QString& fileName, const QByteArray& content) {
+    qDebug() << "Receiving content for file:" << fileName;
 
-        qDebug() << "Updated file list with detailed information (sorted by name).";
+    // Extract and process file content
+    // 바이너리 파일도 중간의 NUL 에서 잘리지 않도록 길이를 지정해서 변환
+    QString fileContent = QString::fromUtf8(content.constData(), content.size()).trimmed();
 
+    showView(fileList);
+    fileList->clear();
+    QStringList fileLines = QString(fileContent).split('\n', Qt::SkipEmptyParts);
+    for (const QString& line : fileLines) {
+        fileList->addItem(QString(line));
     }
+    fileList->addItem(QString("--- Press ESC to go back ---")); // 안내 메시지 추가
+
+    fileList->setStyleSheet("");
+    fileList->update();
 }
 
-void TextStyleFileExplorer::handleDelete() {
-    // 선택된 항목 가져오기
-    QString selectedItem = fileList->currentItem() ? fileList->currentItem()->text() : "";
+void TextStyleFileExplorer::showProcessList(const QByteArray& data) {
+    qDebug() << "Process list received:" << data.size() << "bytes";
+
+    // 프로세스 목록을 fileList에 출력
+    showView(fileList);
+    fileList->clear();
+
+    // 헤더 추가
+    QString header = QString("%1 %2 %3")
+                        .arg("PID", -8)   // 왼쪽 정렬, 8자리
+                        .arg("PPID", -8)  // 왼쪽 정렬, 8자리
+                        .arg("CMD");
+    fileList->addItem(header);
+    fileList->addItem(QString("=").repeated(header.length())); // 구분선 추가
+
+    // "pid ppid cmd" 행을 받은 버퍼 안에서 바로 자른다
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    const char *line, *lineEnd;
+    while (RowTokenizer::nextLine(p, end, line, lineEnd)) {
+        RowTokenizer row(line, lineEnd);
+        QLatin1String pid, ppid, cmd;
+        quint64 pidValue;
+        if (!row.next(pid) || !row.next(ppid) || !row.next(cmd) || !RowTokenizer::toUInt64(pid, pidValue)) {
+            continue;
+        }
 
-    if (selectedItem.isEmpty()) {
-        qDebug() << "No item selected for deletion.";
-        return;
+        // 정렬된 포맷으로 출력 (CMD 는 나머지 전부)
+        QString formattedLine = QString("%1 %2 %3")
+                                    .arg(pid, -8)   // PID, 왼쪽 정렬 8자리
+                                    .arg(ppid, -8)  // PPID, 왼쪽 정렬 8자리
+                                    .arg(QString::fromUtf8(cmd.data(), int(lineEnd - cmd.data())));
+        QListWidgetItem* item = new QListWidgetItem(formattedLine, fileList);
+        item->setData(Qt::UserRole, pidValue); // kill 할 때 다시 파싱하지 않도록
     }
 
-    // 선택된 항목에서 파일/폴더 이름 추출
-    QStringList fields = selectedItem.split(QRegExp("\\s+"), Qt::SkipEmptyParts);
-    if (fields.size() < 6) {
-        qDebug() << "Invalid selected item format.";
+    // 안내 메시지 추가
+    fileList->addItem("--- Press ESC to go back ---");
+
+    fileList->setStyleSheet("");
+    fileList->update();
+}
+
+void TextStyleFileExplorer::showDirectoryListing(const QByteArray& window, const QByteArray& data, bool records) {
+    if (window.size() < 12) {
         return;
     }
 
-    QString type = fields[1];  // 파일/폴더 구분 (DIR, FILE 등)
-    QString name = fields[5];  // 파일/폴더 이름
+    // 구간 정보 (offset, count, total). 행은 서버가 이미 정렬해서 보냄
+    const uchar* header = reinterpret_cast<const uchar*>(window.constData());
+    int offset = qFromBigEndian<quint32>(header);
+    int total = qFromBigEndian<quint32>(header + 8);
 
-    // 명령어 구성
-    QString command;
-    if (type == "DIR") {
-        command = "rmdir " + name + "\n";  // 폴더 삭제
-    } else {
-        command = "rm " + name + "\n";    // 파일 삭제
+    dirModel->setPage(offset, total, data, records);
+    if (offset == 0) {
+        showView(dirView);
+        if (!dirView->currentIndex().isValid() && dirModel->rowCount() > 0) {
+            dirView->setCurrentIndex(dirModel->index(0, 0));
+        }
     }
 
-    // 서버로 명령 전송
-    if (socket->write(command.toUtf8()) == -1) {
-        qDebug() << "Failed to send delete command:" << socket->errorString();
-    } else if (!socket->waitForBytesWritten(3000)) {
-        qDebug() << "Timeout while sending delete command.";
-    } else {
-        qDebug() << "Sent to server:" << command;
-    }
+    qDebug() << "Listing rows" << dirModel->loadedCount() << "of" << dirModel->totalCount();
+}
+
+void TextStyleFileExplorer::handleDelete() {
+    // 선택된 항목 가져오기
+    const DirEntry* entry = selectedEntry();
 
-    if (socket->write("ls") == -1) {
-        qDebug() << "Failed to send ls command:" << socket->errorString();
-    } else if (!socket->waitForReadyRead(3000)) {
-        qDebug() << "Timeout while sending ls command.";
+    if (entry == nullptr) {
+        qDebug() << "No item selected for deletion.";
+        return;
     }
+
+    // 휴지통으로 옮기기만 하므로 폴더도 바로 끝나고, Ctrl+Z 로 되돌릴 수 있다 (응답에 목록 변경분이 같이 옴)
+    connection->request("rm -t " + entry->name + "\n");
 }
 
-void TextStyleFileExplorer::handleCreateFolder() {
-    // 기존 연결 해제
-    disconnect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, nullptr);
-
-    // 새 항목 추가
-    QListWidgetItem* newItem = new QListWidgetItem("New Folder", fileList);
-    newItem->setFlags(newItem->flags() | Qt::ItemIsEditable); // 편집 가능 플래그 설정
-    fileList->addItem(newItem);
-
-    // 새 항목을 선택하고 편집 상태로 전환
-    fileList->setCurrentItem(newItem);
-    fileList->editItem(newItem); // 항목 편집 시작
-
-    // 사용자 입력 완료 후 서버에 전송
-    connect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, [=](QWidget* editor) {
-        QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor);
-        if (lineEdit) {
-            QString folderName = lineEdit->text().trimmed();
-
-            // 이름이 비어 있는 경우 항목 삭제
-            if (folderName.isEmpty()) {
-                delete newItem;
-                return;
-            }
+void TextStyleFileExplorer::handleDeletePermanently() {
+    const DirEntry* entry = selectedEntry();
 
-            // 이름이 유효하면 서버에 mkdir 명령 전송
-            QString command = "mkdir " + folderName + "\n";
-            if (socket->write(command.toUtf8()) == -1) {
-                qDebug() << "Failed to send mkdir command:" << socket->errorString();
-            } else if (!socket->waitForBytesWritten(3000)) {
-                qDebug() << "Timeout while sending cd command.";
-                return;
-            }
+    if (entry == nullptr) {
+        qDebug() << "No item selected for deletion.";
+        return;
+    }
 
-            if (socket->write("ls") == -1) {
-                qDebug() << "Failed to send ls command:" << socket->errorString();
-            } else if (!socket->waitForReadyRead(3000)) {
-                qDebug() << "Timeout while sending ls command.";
+    if (entry->isDir()) {
+        // 폴더는 서버가 안의 내용까지 한 번에 지운다 (백그라운드 작업). 되돌릴 수 없으므로 확인
+        QString name = entry->name;
+        QString question = QString("Delete folder '%1' and everything in it? (y/N)").arg(name);
+        promptInput(question, [this, name](const QString& answer) {
+            if (answer.compare("y", Qt::CaseInsensitive) == 0 || answer.compare("yes", Qt::CaseInsensitive) == 0) {
+                connection->request("rm -r " + name + "\n");
             }
-        }
+        });
+        return;
+    }
+
+    // 파일 삭제. 서버로 명령 전송 (응답에 목록 변경분이 같이 옴)
+    connection->request("rm " + entry->name + "\n");
+}
+
+void TextStyleFileExplorer::handleCreateFolder() {
+    // 사용자 입력 완료 후 서버에 mkdir 명령 전송
+    promptInput("New folder name", [this](const QString& folderName) {
+        connection->request("mkdir " + folderName + "\n");
     });
 }
 
 void TextStyleFileExplorer::handleCreateFile() {
-    // 기존 연결 해제
-    disconnect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, nullptr);
-
-    // 새 항목 추가
-    QListWidgetItem* newItem = new QListWidgetItem("New File", fileList);
-    newItem->setFlags(newItem->flags() | Qt::ItemIsEditable); // 편집 가능 플래그 설정
-    fileList->addItem(newItem);
-
-    // 새 항목을 선택하고 편집 상태로 전환
-    fileList->setCurrentItem(newItem);
-    fileList->editItem(newItem); // 항목 편집 시작
-
-    // 사용자 입력 완료 후 서버에 전송
-    connect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, [=](QWidget* editor) {
-        QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor);
-        if (lineEdit) {
-            QString folderName = lineEdit->text().trimmed();
-
-            // 이름이 비어 있는 경우 항목 삭제
-            if (folderName.isEmpty()) {
-                delete newItem;
-                return;
-            }
-
-            // 이름이 유효하면 서버에 touch 명령 전송
-            QString command = "touch " + folderName + "\n";
-            if (socket->write(command.toUtf8()) == -1) {
-                qDebug() << "Failed to send mkdir command:" << socket->errorString();
-            } else if (!socket->waitForBytesWritten(3000)) {
-                qDebug() << "Timeout while sending cd command.";
-                return;
-            }
-
-            if (socket->write("ls") == -1) {
-                qDebug() << "Failed to send ls command:" << socket->errorString();
-            } else if (!socket->waitForReadyRead(3000)) {
-                qDebug() << "Timeout while sending ls command.";
-            }
-        }
+    // 사용자 입력 완료 후 서버에 touch 명령 전송
+    promptInput("New file name", [this](const QString& fileName) {
+        connection->request("touch " + fileName + "\n");
     });
 }
 
 void TextStyleFileExplorer::handleCopy() {
-    QListWidgetItem* selectedItem = fileList->currentItem();
-    if (!selectedItem) {
+    const DirEntry* entry = selectedEntry();
+    if (entry == nullptr) {
         qDebug() << "No item selected to copy.";
         return;
     }
 
-    // 선택된 항목의 이름 추출
-    QString itemName = selectedItem->text().split(QRegExp("\\s+")).last(); // 파일/폴더 이름만 추출
-    QString type = selectedItem->text().split(QRegExp("\\s+"))[1];         // 파일/폴더 타입 추출 (DIR/FILE)
-
     QString fullPath;
     // 현재 경로와 결합하여 Full Path 생성
-    if (currentPathLabel->text() == "/") fullPath = "/" + itemName;
-    else fullPath = currentPathLabel->text() + "/" + itemName;
+    if (currentPathLabel->text() == "/") fullPath = "/" + entry->name;
+    else fullPath = currentPathLabel->text() + "/" + entry->name;
 
     copiedItem = fullPath; // Full Path 저장
 
     // 폴더인 경우 플래그 설정
-    isDirectory = (type == "DIR");
+    isDirectory = entry->isDir();
     qDebug() << "Copied item (full path):" << copiedItem << ", isDirectory:" << isDirectory;
 }
 
@@ -513,275 +708,184 @@ void TextStyleFileExplorer::handlePaste() {
         command = QString("cp %1 %2").arg(copiedItem, destinationPath);
     }
 
-    // 서버에 cp 명령 전송
-    if (socket->write(command.toUtf8()) == -1) {
-        qDebug() << "Failed to send cp command:" << socket->errorString();
-    } else if (!socket->waitForBytesWritten(3000)) {
-        qDebug() << "Timeout while sending ls command.";
-    } else {
-        qDebug() << "Sent to server:" << command;
-    }
+    // 서버에 cp 명령 전송. 백그라운드 작업으로 돌고, 진행 상황과 목록 변경분은 id 0 응답으로 옴
+    connection->request(command);
+}
 
-    if (socket->write("ls") == -1) {
-        qDebug() << "Failed to send ls command:" << socket->errorString();
-    } else if (!socket->waitForReadyRead(3000)) {
-        qDebug() << "Timeout while sending ls command.";
+// 마지막으로 받은 목록 이후의 변경분만 요청한다 (외부에서 바뀐 것 포함)
+void TextStyleFileExplorer::syncDirectory() {
+    if (dirModel->version() == 0) {
+        handleRefreshDirectory();
+        return;
     }
+    syncRequest = connection->request(QString("ls since %1").arg(dirModel->version()));
 }
 
 void TextStyleFileExplorer::handleRefreshDirectory() {
-    // 서버에 ls 명령 전송
-    if (socket->write("ls\n") == -1) {
-        qDebug() << "Failed to send ls command:" << socket->errorString();
-        return;
-    }
-    if (!socket->waitForBytesWritten(3000)) {
-        qDebug() << "Timeout while sending ls command.";
-        return;
-    }
-    qDebug() << "Sent to server: ls";
+    // 지금까지 받은 만큼 첫 페이지부터 다시 받기
+    requestListing(0, qMax(dirModel->loadedCount(), kListingPageSize));
+    qDebug() << "Sent to server: ls -w";
 }
 
 void TextStyleFileExplorer::handleShowProcessList() {
     // 서버에 ps 명령 전송
-    if (socket->write("ps\n") == -1) {
-        qDebug() << "Failed to send ps command:" << socket->errorString();
-        return;
-    }
-    if (!socket->waitForBytesWritten(3000)) {
-        qDebug() << "Timeout while sending ps command.";
-        return;
-    }
+    connection->request("ps\n");
     qDebug() << "Sent to server: ps";
 }
 
 void TextStyleFileExplorer::handleRunProcess() {
     // 선택된 파일 가져오기
-    QListWidgetItem* selectedItem = fileList->currentItem();
-    if (!selectedItem) {
+    const DirEntry* entry = selectedEntry();
+    if (entry == nullptr) {
         qDebug() << "No file selected to run.";
         return;
     }
 
-    // 선택된 항목에서 파일 이름 추출
-    QString fileName = selectedItem->text().split(QRegExp("\\s+")).last(); // 마지막 필드가 파일 이름
-    fileName.remove('\"'); // 따옴표 제거
-
-    if (fileName.isEmpty()) {
-        qDebug() << "Invalid file name.";
-        return;
-    }
-
     // 서버에 exec 명령 전송
-    QString command = QString("exec %1").arg(fileName);
-    if (socket->write(command.toUtf8()) == -1) {
-        qDebug() << "Failed to send exec command:" << socket->errorString();
-        return;
-    }
-
-    if (!socket->waitForBytesWritten(3000)) {
-        qDebug() << "Timeout while sending exec command.";
-        return;
-    }
-
-    qDebug() << "Sent to server: exec" << fileName;
+    QString command = QString("exec %1").arg(entry->name);
+    connection->request(command);
+    qDebug() << "Sent to server: exec" << entry->name;
 }
 
 void TextStyleFileExplorer::handleKillProcess() {
-    // 현재 선택된 항목 가져오기
-    QListWidgetItem* selectedItem = fileList->currentItem();
+    // 현재 선택된 항목 가져오기 (프로세스 목록이 보일 때만)
+    QListWidgetItem* selectedItem = fileList->isVisible() ? fileList->currentItem() : nullptr;
     if (!selectedItem) {
         qDebug() << "No process selected to kill.";
         return;
     }
 
-    // PID 추출
-    QStringList fields = selectedItem->text().split(QRegExp("\\s+"), Qt::SkipEmptyParts);
-    if (fields.size() >= 1) {
-        QString pid = fields[0]; // 첫 번째 필드는 PID
+    // 목록을 만들 때 저장해 둔 PID
+    QVariant pidData = selectedItem->data(Qt::UserRole);
+    if (pidData.isValid()) {
+        QString pid = QString::number(pidData.toULongLong());
 
         // 서버에 kill 명령 전송
         QString command = QString("kill %1\n").arg(pid);
-        if (socket->write(command.toUtf8()) == -1) {
-            qDebug() << "Failed to send kill command:" << socket->errorString();
-            return;
-        }
-        if (!socket->waitForBytesWritten(3000)) {
-            qDebug() << "Timeout while sending kill command.";
-            return;
-        }
+        connection->request(command);
         qDebug() << "Sent to server: kill" << pid;
 
-        if (socket->write("ps\n") == -1) {
-        qDebug() << "Failed to send ps command:" << socket->errorString();
-        return;
-        }
-        if (!socket->waitForBytesWritten(3000)) {
-            qDebug() << "Timeout while sending ps command.";
-            return;
-        }
+        connection->request("ps\n");
         qDebug() << "Sent to server: ps";
-       
     } else {
         qDebug() << "Invalid process entry format.";
     }
 }
 
 void TextStyleFileExplorer::handleChangePermission() {
-    // 기존 연결 해제
-    disconnect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, nullptr);
     // 현재 선택된 파일/폴더 가져오기
-    QListWidgetItem* selectedItem = fileList->currentItem();
-    if (!selectedItem) {
+    const DirEntry* entry = selectedEntry();
+    if (entry == nullptr) {
         qDebug() << "No item selected to change permission.";
         return;
     }
-
-    // 선택된 항목에서 파일/폴더 이름 추출
-    QString itemName = selectedItem->text().split(QRegExp("\\s+")).last(); // 마지막 필드가 파일 이름
-    itemName.remove('\"'); // 따옴표 제거
-
-    if (itemName.isEmpty()) {
-        qDebug() << "Invalid item name.";
-        return;
-    }
-
-    // 새 편집 가능한 아이템 생성
-    QListWidgetItem* editItem = new QListWidgetItem("Enter new permissions (e.g., 777)", fileList);
-    editItem->setFlags(editItem->flags() | Qt::ItemIsEditable); // 편집 가능 플래그 설정
-    fileList->addItem(editItem);
-
-    // 새 항목을 선택하고 편집 상태로 전환
-    fileList->setCurrentItem(editItem);
-    fileList->editItem(editItem);
+    QString itemName = entry->name;
 
     // 사용자 입력 완료 후 처리
-    connect(fileList->itemDelegate(), &QAbstractItemDelegate::commitData, this, [=](QWidget* editor) {
-        QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor);
-        if (lineEdit) {
-            QString permission = lineEdit->text().trimmed();
-
-            // 유효한 권한 값인지 확인 (예: 777)
-            QRegExp regex("^[0-7]{3}$");
-            if (!regex.exactMatch(permission)) {
-                fileList->removeItemWidget(editItem);
-                delete editItem;
-                return;
-            }
-
-            // 서버에 chmod 명령 전송
-            QString command = QString("chmod %1 %2\n").arg(permission).arg(itemName);
-            if (socket->write(command.toUtf8()) == -1) {
-                qDebug() << "Failed to send chmod command:" << socket->errorString();
-                return;
-            }
-            if (!socket->waitForBytesWritten(3000)) {
-                qDebug() << "Timeout while sending chmod command.";
-                return;
-            }
+    promptInput("Enter new permissions (e.g., 777)", [this, itemName](const QString& permission) {
+        // 유효한 권한 값인지 확인 (예: 777)
+        QRegExp regex("^[0-7]{3}$");
+        if (!regex.exactMatch(permission)) {
+            return;
+        }
 
-            qDebug() << "Sent to server: chmod" << permission << itemName;
+        // 서버에 chmod 명령 전송
+        QString command = QString("chmod %1 %2\n").arg(permission).arg(itemName);
+        connection->request(command);
 
-            if (socket->write("ls") == -1) {
-                qDebug() << "Failed to send chmod command:" << socket->errorString();
-                return;
-            }
-            if (!socket->waitForReadyRead(3000)) {
-                qDebug() << "Timeout while sending chmod command.";
-                return;
-            }
-        }
-        fileList->removeItemWidget(editItem);
-        delete editItem;
+        qDebug() << "Sent to server: chmod" << permission << itemName;
     });
 }
 
 void TextStyleFileExplorer::handleCreateSoftLink() {
-    QListWidgetItem* selectedItem = fileList->currentItem();
-    if (!selectedItem) {
+    const DirEntry* entry = selectedEntry();
+    if (entry == nullptr) {
         qDebug() << "No file selected to create a soft link.";
         return;
     }
 
-    QString targetFile = selectedItem->text().split(QRegExp("\\s+")).last(); // 파일/폴더 이름
-    targetFile.remove('\"');
-
-    if (targetFile.isEmpty()) {
-        qDebug() << "Invalid file name.";
-        return;
-    }
+    QString targetFile = entry->name; // 파일/폴더 이름
 
     // 사용자에게 소프트 링크 이름 입력받기
-    bool ok;
+    bool ok = true;
     QString linkName = targetFile + ".soft";
 
     if (ok && !linkName.trimmed().isEmpty()) {
         // 서버에 소프트 링크 생성 명령 전송
         QString command = QString("ln -s %1 %2\n").arg(targetFile).arg(linkName.trimmed());
-        if (socket->write(command.toUtf8()) == -1) {
-            qDebug() << "Failed to send soft link command:" << socket->errorString();
-            return;
-        }
-        if (!socket->waitForBytesWritten(3000)) {
-            qDebug() << "Timeout while sending soft link command.";
-            return;
-        }
+        connection->request(command);
 
         qDebug() << "Sent to server: ln -s" << targetFile << linkName;
-        handleRefreshDirectory();
     }
 }
 
 void TextStyleFileExplorer::handleCreateHardLink() {
-    QListWidgetItem* selectedItem = fileList->currentItem();
-    if (!selectedItem) {
+    const DirEntry* entry = selectedEntry();
+    if (entry == nullptr) {
         qDebug() << "No file selected to create a hard link.";
         return;
     }
 
-    QString targetFile = selectedItem->text().split(QRegExp("\\s+")).last(); // 파일/폴더 이름
-    targetFile.remove('\"');
-
-    if (targetFile.isEmpty()) {
-        qDebug() << "Invalid file name.";
-        return;
-    }
+    QString targetFile = entry->name; // 파일/폴더 이름
 
     // 사용자에게 하드 링크 이름 입력받기
-    bool ok;
+    bool ok = true;
     QString linkName = targetFile + ".hard";
 
     if (ok && !linkName.trimmed().isEmpty()) {
         // 서버에 하드 링크 생성 명령 전송
         QString command = QString("ln %1 %2\n").arg(targetFile).arg(linkName.trimmed());
-        if (socket->write(command.toUtf8()) == -1) {
-            qDebug() << "Failed to send hard link command:" << socket->errorString();
-            return;
-        }
-        if (!socket->waitForBytesWritten(3000)) {
-            qDebug() << "Timeout while sending hard link command.";
-            return;
-        }
+        connection->request(command);
 
         qDebug() << "Sent to server: ln" << targetFile << linkName;
-        handleRefreshDirectory();
     }
 }
 
 void TextStyleFileExplorer::handleGoToRootDirectory() {
-    QString command = "cd /\n";
+    // 서버에 go / 명령 전송 (경로 + 목록 첫 페이지)
+    connection->request(QString("go / %1 name").arg(kListingPageSize));
+}
+
+void TextStyleFileExplorer::handleShowJobs() {
+    // 끝난 작업까지 서버가 기억하는 작업 전부
+    jobsRequest = connection->request("jobs");
+}
 
-    // 서버에 cd / 명령 전송
-    if (socket->write(command.toUtf8()) == -1) {
-        qDebug() << "Failed to send cd / command:" << socket->errorString();
+void TextStyleFileExplorer::handleCancelJob() {
+    if (runningJobs.isEmpty()) {
+        qDebug() << "No running job to cancel.";
         return;
     }
 
-    if (!socket->waitForReadyRead(3000)) {
-        qDebug() << "Timeout while sending cd / command.";
-        return;
+    // 가장 최근에 시작한 작업. 결과는 작업이 멈춘 뒤 id 0 응답으로 옴
+    quint32 id = runningJobs.lastKey();
+    connection->request(QString("cancel %1").arg(id));
+    qDebug() << "Sent to server: cancel" << id;
+}
+
+void TextStyleFileExplorer::handleShowTrash() {
+    trashRequest = connection->request("trash");
+}
+
+void TextStyleFileExplorer::handleRestore() {
+    // 휴지통 목록이 보이면 선택한 항목, 아니면 이 창에서 마지막으로 휴지통에 보낸 항목
+    QListWidgetItem* selectedItem = fileList->isVisible() ? fileList->currentItem() : nullptr;
+    QString trashId = selectedItem ? selectedItem->data(kTrashIdRole).toString() : QString();
+    bool fromList = !trashId.isEmpty();
+
+    if (!fromList) {
+        if (trashedIds.isEmpty()) {
+            qDebug() << "Nothing to restore.";
+            return;
+        }
+        trashId = trashedIds.last();
     }
+    trashedIds.removeAll(trashId);
 
-    qDebug() << "Sent to server: cd /";
-    handleRefreshDirectory();
+    // 원래 경로로 되돌린다. 그 자리에 이미 같은 이름이 있으면 서버가 거부한다
+    connection->request("restore " + trashId);
+    qDebug() << "Sent to server: restore" << trashId;
+    if (fromList) {
+        handleShowTrash();
+    }
 }
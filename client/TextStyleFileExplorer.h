@@ -7,10 +7,18 @@
 #include <QLabel>
 #include <QKeyEvent>
 #include <QListWidget>
+#include <QListView>
+#include <QTableView>
 #include <QLineEdit>
 #include <QStringList>
 #include <QPalette>
-#include <QTcpSocket>
+#include <QHash>
+#include <QMap>
+#include <functional>
+#include "ServerConnection.h"
+#include "DirectoryModel.h"
+#include "FileViewModel.h"
+#include "JobStatus.h"
 
 class TextStyleFileExplorer : public QWidget {
 public:
@@ -23,21 +31,57 @@ protected:
 private:
     QLabel* commandHelpLabel;
     QLabel* currentPathLabel;
-    QListWidget* fileList;
-    QLineEdit* commandInput;
-    QTcpSocket* socket;
+    QTableView* dirView;        // 디렉토리 목록
+    DirectoryModel* dirModel;
+    QListWidget* fileList;      // 프로세스 목록 등 텍스트 출력
+    QListView* fileView;        // 파일 내용 보기
+    FileViewModel* fileModel;
+    QLineEdit* commandInput;    // 이름/권한 입력 프롬프트
+    QLabel* jobLabel;           // 실행 중인 백그라운드 작업 (cp, rm -r, exec) 진행 상황
+    std::function<void(const QString&)> promptCallback;
+    ServerConnection* connection;
+    QHash<quint32, quint64> fileRequests; // fileModel 이 보낸 cat 요청 id -> 첫 줄 번호
+    quint32 syncRequest = 0;    // 진행 중인 "ls since" 요청 id
+    quint32 jobsRequest = 0;    // 목록을 보여줄 "jobs" 요청 id
+    QMap<quint32, JobStatus> runningJobs; // 작업 id 순
+    QString lastJobResult;      // 마지막으로 끝난 작업 (실행 중인 작업이 없을 때 표시)
+    quint32 trashRequest = 0;   // 목록을 보여줄 "trash" 요청 id
+    QStringList trashedIds;     // 이 창에서 휴지통으로 보낸 항목 id (Ctrl+Z 는 최근 것부터 복구)
     QString copiedItem;
     bool isDirectory;
 
+    // 큰 디렉토리는 서버에서 정렬한 목록을 페이지 단위로 받는다
+    static constexpr int kListingPageSize = 200;
+    // 휴지통 목록 항목에 넣어 두는 id (프로세스 목록의 PID 는 Qt::UserRole)
+    static constexpr int kTrashIdRole = Qt::UserRole + 1;
+
+    void handleReply(quint32 id, const ServerReply& reply);
+    void showFileContent(const QString& fileName, const QByteArray& content);
+    void showProcessList(const QByteArray& data);
+    void showDirectoryListing(const QByteArray& window, const QByteArray& data, bool records);
+    void showView(QWidget* view);
+    void requestListing(int offset, int count);
+    void syncDirectory();
+    void applyVersion(const QByteArray& version, const QByteArray& delta);
+    void handleNotify(quint8 flags);
+    void updateJobs(const QByteArray& data);
+    void showJobList(const QByteArray& data);
+    void showTrashList(const QByteArray& data);
+    void openFileViewer(const QString& path);
+    void closeFileViewer();
+    void handleFileBlock(quint64 requestedLine, const ServerReply& reply);
+    void promptInput(const QString& placeholder, std::function<void(const QString&)> onDone);
+    const DirEntry* selectedEntry() const;
+
     void moveSelection(int step);
     void handleEnter();
     void handleDelete();
+    void handleDeletePermanently();
     void handleCreateFolder();
     void handleCreateFile();
     void handleCopy();
     void handlePaste();
     void handleRefreshDirectory();
-    void onServerResponse();
     void handleShowProcessList();
     void handleRunProcess();
     void handleKillProcess();
@@ -45,6 +89,10 @@ private:
     void handleCreateSoftLink();
     void handleCreateHardLink();
     void handleGoToRootDirectory();
+    void handleShowJobs();
+    void handleCancelJob();
+    void handleShowTrash();
+    void handleRestore();
 };
 
 #endif // TEXT_STYLE_FILE_EXPLORER_H
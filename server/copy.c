@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include "copy.h"
+
+static int write_all(int fd, const char *buf, size_t len, off_t off)
+{
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+        off += n;
+    }
+    return 0;
+}
+
+/* 이 방법을 지원하지 않는 파일시스템/파일이면 다음 방법으로 */
+static int unsupported(int err)
+{
+    return err == EXDEV || err == ENOSYS || err == EINVAL || err == EOPNOTSUPP || err == ENOTTY;
+}
+
+static int cancelled(const copy_ctl_t *ctl)
+{
+    if (ctl && ctl->cancel && __atomic_load_n(ctl->cancel, __ATOMIC_RELAXED)) {
+        errno = ECANCELED;
+        return 1;
+    }
+    return 0;
+}
+
+static void report(const copy_ctl_t *ctl, uint64_t files, uint64_t bytes)
+{
+    if (ctl && ctl->progress && (files || bytes)) {
+        ctl->progress(ctl->arg, files, bytes);
+    }
+}
+
+/* [off, end) 구간을 같은 위치로 복사한다 */
+static int copy_range(int src, int dst, off_t off, off_t end, int *method, char **buf, const copy_ctl_t *ctl)
+{
+    while (off < end) {
+        size_t  want = end - off < COPY_CHUNK ? (size_t)(end - off) : COPY_CHUNK;
+        ssize_t n;
+
+        if (cancelled(ctl)) {
+            return -1;
+        }
+
+        if (*method == COPY_RANGE) {
+            loff_t in = off, out = off;
+            n = copy_file_range(src, &in, dst, &out, want, 0);
+            // 일부 파일시스템은 지원하지 않으면 오류 대신 0 을 돌려준다
+            if ((n < 0 && unsupported(errno)) || n == 0) {
+                *method = COPY_SENDFILE;
+                continue;
+            }
+        } else if (*method == COPY_SENDFILE) {
+            off_t in = off;
+            if (lseek(dst, off, SEEK_SET) < 0) {
+                return -1;
+            }
+            n = sendfile(dst, src, &in, want);
+            if (n < 0 && unsupported(errno)) {
+                *method = COPY_RW;
+                continue;
+            }
+        } else {
+            if (*buf == NULL && (*buf = malloc(COPY_BUF_SIZE)) == NULL) {
+                return -1;
+            }
+            n = pread(src, *buf, want < COPY_BUF_SIZE ? want : COPY_BUF_SIZE, off);
+            if (n > 0 && write_all(dst, *buf, n, off) < 0) {
+                return -1;
+            }
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            break;  // 복사하는 중에 파일이 줄어듦
+        }
+        off += n;
+        report(ctl, 0, n);
+    }
+    return 0;
+}
+
+/* 크기를 알 수 없는 파일 (파이프 등) 은 끝까지 읽어서 쓴다 */
+static int copy_stream(int src, int dst)
+{
+    char   *buf = malloc(COPY_BUF_SIZE);
+    off_t   off = 0;
+    ssize_t n;
+
+    if (buf == NULL) {
+        return -1;
+    }
+    while ((n = read(src, buf, COPY_BUF_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (write_all(dst, buf, n, off) < 0) {
+            n = -1;
+            break;
+        }
+        off += n;
+    }
+    free(buf);
+    return n < 0 ? -1 : COPY_RW;
+}
+
+int copy_fd(int src, int dst, const struct stat *st, const copy_ctl_t *ctl)
+{
+    int   method = COPY_RANGE;
+    char *buf = NULL;
+    off_t off = 0, end = st->st_size;
+
+    if (!S_ISREG(st->st_mode)) {
+        return copy_stream(src, dst);
+    }
+
+    // 같은 파일시스템에서 reflink 가 되면 데이터는 공유하고 끝
+    if (end > 0 && ioctl(dst, FICLONE, src) == 0) {
+        report(ctl, 0, end);
+        return COPY_CLONE;
+    }
+
+    // 데이터가 있는 구간만 복사하고 구멍은 건너뛴다
+    while (off < end) {
+        off_t data = lseek(src, off, SEEK_DATA);
+        off_t hole;
+
+        if (data < 0 && errno == ENXIO) {
+            break;                          // 나머지는 전부 구멍
+        }
+        if (data < 0) {
+            if (!unsupported(errno)) {
+                goto fail;
+            }
+            data = off;                     // SEEK_DATA 를 모르는 파일시스템
+            hole = end;
+        } else if ((hole = lseek(src, data, SEEK_HOLE)) < 0 || hole > end) {
+            hole = end;
+        }
+        if (data >= end) {
+            break;
+        }
+
+        report(ctl, 0, data - off);         // 건너뛴 구멍
+        if (copy_range(src, dst, data, hole, &method, &buf, ctl) < 0) {
+            goto fail;
+        }
+        off = hole;
+    }
+
+    // 끝부분의 구멍은 크기만 맞춘다
+    if (ftruncate(dst, end) < 0) {
+        goto fail;
+    }
+    if (off < end) {
+        report(ctl, 0, end - off);
+    }
+    free(buf);
+    return method;
+
+fail:
+    free(buf);
+    return -1;
+}
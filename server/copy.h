@@ -0,0 +1,30 @@
+#ifndef MYSH_COPY_H
+#define MYSH_COPY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define COPY_CHUNK          (64 * 1024 * 1024)  // copy_file_range/sendfile 한 번에 요청하는 크기
+#define COPY_BUF_SIZE       (1024 * 1024)       // read/write 로 복사할 때의 버퍼
+
+/* 파일 내용을 복사한 방법. 앞의 것부터 시도하고 안 되면 다음 것으로 내려간다 */
+enum copy_method {
+    COPY_CLONE,         // FICLONE (btrfs/XFS reflink, 데이터 복사 없음)
+    COPY_RANGE,         // copy_file_range (커널 안에서 복사)
+    COPY_SENDFILE,      // sendfile
+    COPY_RW,            // read/write
+};
+
+/* 오래 걸리는 복사의 진행 상황 보고와 취소 (백그라운드 작업). 여러 스레드에서 부른다 */
+typedef struct copy_ctl {
+    void      (*progress)(void *arg, uint64_t files, uint64_t bytes); // 늘어난 만큼 (구멍도 bytes 에 포함)
+    void       *arg;
+    const int  *cancel;         // 0 이 아니게 되면 ECANCELED 로 멈춘다
+} copy_ctl_t;
+
+/* src 의 내용을 비어 있는 dst 에 복사한다 (st 는 src 의 fstat). 구멍은 구멍으로 남긴다.
+ * ctl 은 NULL 이어도 된다. 성공하면 마지막으로 쓴 copy_method, 실패하면 -1 (errno) */
+int copy_fd(int src, int dst, const struct stat *st, const copy_ctl_t *ctl);
+
+#endif // MYSH_COPY_H
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dcache.h"
+#include "watch.h"
+
+/* 디렉토리 하나의 캐시 항목. 스냅샷이 없으면 스캔 중이거나 무효가 된 상태 */
+typedef struct dcache_entry {
+    dev_t       dev;
+    ino_t       ino;
+    struct timespec mtime;          // 스캔을 시작할 때의 디렉토리 (inotify 가 없을 때의 확인용)
+    struct timespec ctime;
+    dir_snapshot_t *snap;
+    size_t      bytes;
+    uint64_t    gen;                // 바뀔 때마다 새 값 (스캔 중에 바뀌었는지 확인)
+    int         wd;                 // inotify 감시 (-1 이면 없음)
+    struct dcache_entry *hnext;
+    struct dcache_entry *prev;      // LRU 목록 (앞쪽이 최근)
+    struct dcache_entry *next;
+} dcache_entry_t;
+
+#define DCACHE_MAX_ENTRIES  (4096)  // 스냅샷 없는 항목까지 포함한 최대 개수
+
+static dcache_entry_t *buckets[DCACHE_BUCKETS];
+static dcache_entry_t lru = { .prev = &lru, .next = &lru };
+static dcache_stats_t stats;
+static uint64_t next_gen = 1;
+
+void dcache_init(void)
+{
+    const char *mb = getenv("MYSH_DCACHE_MB");
+
+    stats.budget = (size_t)(mb ? strtoul(mb, NULL, 10) : DCACHE_DEFAULT_MB) * 1024 * 1024;
+}
+
+static unsigned bucket_of(dev_t dev, ino_t ino)
+{
+    return (unsigned)((ino * 31 + dev) % DCACHE_BUCKETS);
+}
+
+static dcache_entry_t *find(dev_t dev, ino_t ino)
+{
+    for (dcache_entry_t *e = buckets[bucket_of(dev, ino)]; e; e = e->hnext) {
+        if (e->dev == dev && e->ino == ino) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void lru_unlink(dcache_entry_t *e)
+{
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+static void lru_touch(dcache_entry_t *e)
+{
+    lru_unlink(e);
+    e->next = lru.next;
+    e->prev = &lru;
+    lru.next->prev = e;
+    lru.next = e;
+}
+
+static void drop_snap(dcache_entry_t *e)
+{
+    if (e->snap) {
+        stats.bytes -= e->bytes;
+        snapshot_free(e->snap);     // 아직 보내는 중인 목록이 있으면 거기서 마저 해제
+        e->snap = NULL;
+        e->bytes = 0;
+    }
+}
+
+static void invalidate(dcache_entry_t *e)
+{
+    if (e->snap) {
+        stats.invalidations++;
+    }
+    drop_snap(e);
+    e->gen = next_gen++;
+}
+
+static void remove_entry(dcache_entry_t *e)
+{
+    for (dcache_entry_t **pp = &buckets[bucket_of(e->dev, e->ino)]; *pp; pp = &(*pp)->hnext) {
+        if (*pp == e) {
+            *pp = e->hnext;
+            break;
+        }
+    }
+    lru_unlink(e);
+    drop_snap(e);
+    watch_cache_remove(e->wd, e);
+    free(e);
+    stats.entries--;
+}
+
+/* 예산을 넘으면 가장 오래 안 쓴 디렉토리부터 버린다 */
+static void evict(void)
+{
+    while (lru.prev != &lru && (stats.bytes > stats.budget || stats.entries > DCACHE_MAX_ENTRIES)) {
+        dcache_entry_t *e = lru.prev;
+        if (e->snap) {
+            stats.evictions++;
+        }
+        remove_entry(e);
+    }
+}
+
+static int same_stamp(const dcache_entry_t *e, const struct stat *st)
+{
+    return e->mtime.tv_sec == st->st_mtim.tv_sec && e->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+           e->ctime.tv_sec == st->st_ctim.tv_sec && e->ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
+
+/* 스캔 시작 전에 감시를 먼저 걸어 둔다. 돌려준 값을 dcache_put 에 넘긴다 (0 이면 캐시 안 함) */
+uint64_t dcache_begin(int dfd, const struct stat *dst)
+{
+    dcache_entry_t *e;
+
+    if (stats.budget == 0) {
+        return 0;
+    }
+
+    e = find(dst->st_dev, dst->st_ino);
+    if (e == NULL) {
+        e = calloc(1, sizeof(dcache_entry_t));
+        if (e == NULL) {
+            return 0;
+        }
+        e->dev = dst->st_dev;
+        e->ino = dst->st_ino;
+        e->gen = next_gen++;
+        e->prev = e->next = e;
+        e->hnext = buckets[bucket_of(e->dev, e->ino)];
+        buckets[bucket_of(e->dev, e->ino)] = e;
+        e->wd = watch_cache_add(dfd, e);
+        stats.entries++;
+    } else if (!same_stamp(e, dst)) {
+        invalidate(e);
+    }
+
+    e->mtime = dst->st_mtim;
+    e->ctime = dst->st_ctim;
+    lru_touch(e);
+    evict();
+
+    return find(dst->st_dev, dst->st_ino) ? e->gen : 0;
+}
+
+/* 스캔한 결과를 캐시에 넣는다 (snap 참조 하나를 가져간다) */
+void dcache_put(dir_snapshot_t *snap, uint64_t ticket)
+{
+    dcache_entry_t *e = find(snap->dev, snap->ino);
+    size_t bytes = snapshot_bytes(snap);
+
+    // 스캔 중에 바뀌었거나 혼자서 예산의 절반을 넘는 디렉토리는 넣지 않는다
+    if (e == NULL || ticket == 0 || e->gen != ticket || bytes > stats.budget / 2) {
+        snapshot_free(snap);
+        return;
+    }
+
+    drop_snap(e);
+    e->snap = snap;
+    e->bytes = bytes;
+    stats.bytes += bytes;
+    lru_touch(e);
+    evict();
+}
+
+dir_snapshot_t *dcache_get(int dfd)
+{
+    struct stat st;
+    dcache_entry_t *e;
+
+    if (stats.budget == 0) {
+        return NULL;
+    }
+
+    // 아직 읽지 않은 inotify 이벤트부터 반영해야 방금 바뀐 디렉토리를 내주지 않는다
+    watch_handle_inotify();
+
+    if (fstat(dfd, &st) < 0) {
+        return NULL;
+    }
+
+    e = find(st.st_dev, st.st_ino);
+    if (e && e->snap && !same_stamp(e, &st)) {
+        invalidate(e);
+    }
+    if (e == NULL || e->snap == NULL) {
+        stats.misses++;
+        return NULL;
+    }
+
+    stats.hits++;
+    lru_touch(e);
+    return snapshot_ref(e->snap);
+}
+
+int dcache_holds(const dir_snapshot_t *snap)
+{
+    dcache_entry_t *e = find(snap->dev, snap->ino);
+
+    return e != NULL && e->snap == snap;
+}
+
+void dcache_resize(const dir_snapshot_t *snap)
+{
+    dcache_entry_t *e = find(snap->dev, snap->ino);
+
+    if (e == NULL || e->snap != snap) {
+        return;
+    }
+    stats.bytes -= e->bytes;
+    e->bytes = snapshot_bytes(snap);
+    stats.bytes += e->bytes;
+    evict();
+}
+
+void dcache_invalidate(dev_t dev, ino_t ino)
+{
+    dcache_entry_t *e = find(dev, ino);
+
+    if (e) {
+        invalidate(e);
+    }
+}
+
+/* 감시 중인 디렉토리에서 무언가 바뀌었다. gone 이면 inotify 감시도 없어졌다 */
+void dcache_event(void *owner, int gone)
+{
+    dcache_entry_t *e = owner;
+
+    invalidate(e);
+    if (gone) {
+        e->wd = -1;
+    }
+}
+
+void dcache_flush(void)
+{
+    for (dcache_entry_t *e = lru.next; e != &lru; e = e->next) {
+        invalidate(e);
+    }
+}
+
+void dcache_get_stats(dcache_stats_t *st)
+{
+    *st = stats;
+}
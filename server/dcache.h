@@ -0,0 +1,39 @@
+#ifndef MYSH_DCACHE_H
+#define MYSH_DCACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+#define DCACHE_DEFAULT_MB   (64)        // MYSH_DCACHE_MB 로 바꿀 수 있다 (0 이면 끔)
+#define DCACHE_BUCKETS      (256)
+
+/* 캐시 상태 (cache 명령) */
+typedef struct dcache_stats {
+    uint64_t    hits;
+    uint64_t    misses;
+    uint64_t    evictions;          // 예산을 넘어서 버린 스냅샷
+    uint64_t    invalidations;      // 디렉토리가 바뀌어서 버린 스냅샷
+    size_t      bytes;
+    size_t      budget;
+    uint32_t    entries;
+} dcache_stats_t;
+
+void dcache_init(void);
+
+/* 디렉토리를 스캔하기 전에 부른다. 스캔 중에 바뀌면 dcache_put 이 결과를 버린다 */
+uint64_t dcache_begin(int dfd, const struct stat *dst);
+void dcache_put(dir_snapshot_t *snap, uint64_t ticket);
+
+/* dfd 디렉토리의 유효한 스냅샷 (참조를 하나 늘려서 준다. snapshot_free 로 놓는다) */
+dir_snapshot_t *dcache_get(int dfd);
+
+int  dcache_holds(const dir_snapshot_t *snap);   // 캐시에 들어 있는 (바뀌지 않는) 스냅샷인지
+void dcache_resize(const dir_snapshot_t *snap);  // 스냅샷에 목록 바이트를 붙인 뒤 크기 다시 계산
+void dcache_invalidate(dev_t dev, ino_t ino);
+void dcache_event(void *owner, int gone); // inotify 이벤트 (owner 는 watch_cache_add 에 넘긴 항목)
+void dcache_flush(void);
+void dcache_get_stats(dcache_stats_t *st);
+
+#endif // MYSH_DCACHE_H
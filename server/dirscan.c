@@ -0,0 +1,521 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "dirscan.h"
+
+/* 커널이 getdents64 로 돌려주는 레코드 */
+struct linux_dirent64 {
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+/* 목록 프로토콜이 실제로 보내는 필드만 요청 (ino 는 d_ino, blocks 등은 제외) */
+#define DIRSCAN_STATX_MASK  (STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID | \
+                             STATX_ATIME | STATX_MTIME | STATX_CTIME | STATX_SIZE)
+#define DIRSCAN_STATX_FLAGS (AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT)
+
+#define URING_DEPTH         (64)    // 동시에 띄워 두는 statx 요청 수
+#define POOL_THREADS        (8)     // io_uring 을 못 쓸 때 statx 를 나눠 할 스레드 수
+#define PARALLEL_MIN        (8)     // 이보다 적으면 그냥 순서대로 statx
+
+/* statx 를 어떻게 할지 */
+enum stat_backend {
+    STAT_SERIAL,
+    STAT_THREADS,
+    STAT_URING,
+};
+
+static int backend = STAT_SERIAL;
+
+/* ---------------------------------------------------------------------------
+ * io_uring (liburing 없이 시스템 콜로 직접 링을 다룬다)
+ */
+typedef struct uring {
+    int                  fd;
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+} uring_t;
+
+static uring_t ring = { .fd = -1 };
+
+static int uring_setup(uring_t *r, unsigned entries)
+{
+    struct io_uring_params p;
+    void *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) {
+        return -1;
+    }
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cq = sq;
+    } else {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            goto fail;
+        }
+    }
+
+    r->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        goto fail;
+    }
+
+    r->sq_head  = (unsigned *)((char *)sq + p.sq_off.head);
+    r->sq_tail  = (unsigned *)((char *)sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)((char *)sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((char *)sq + p.sq_off.array);
+    r->cq_head  = (unsigned *)((char *)cq + p.cq_off.head);
+    r->cq_tail  = (unsigned *)((char *)cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)((char *)cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((char *)cq + p.cq_off.cqes);
+    return 0;
+
+fail:
+    // 프로세스 수명 동안 한 번만 시도하므로 mmap 정리는 생략
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+}
+
+static void uring_push_statx(uring_t *r, int dfd, const char *name, unsigned mask,
+                             struct statx *buf, uint64_t user_data)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = dfd;
+    sqe->addr = (uint64_t)(uintptr_t)name;
+    sqe->len = mask;
+    sqe->off = (uint64_t)(uintptr_t)buf;
+    sqe->statx_flags = DIRSCAN_STATX_FLAGS;
+    sqe->user_data = user_data;
+
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------------------
+ * statx 스레드 풀 (io_uring 을 쓸 수 없을 때)
+ */
+typedef struct stat_job {
+    dir_scan_t  *sc;
+    dir_entry_t *ent;
+    int          count;
+    unsigned     mask;
+    int          next;          // 다음에 가져갈 항목 (원자적으로 증가)
+} stat_job_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  work;
+    pthread_cond_t  done;
+    pthread_mutex_t busy;       // 한 번에 작업 하나만
+    stat_job_t     *job;
+    unsigned        generation;
+    int             active;     // job 을 잡고 일하는 스레드 수
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .busy = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void apply_statx(dir_entry_t *e, const struct statx *stx)
+{
+    e->mode = stx->stx_mode;
+    e->uid = stx->stx_uid;
+    e->gid = stx->stx_gid;
+    e->atime = stx->stx_atime.tv_sec;
+    e->mtime = stx->stx_mtime.tv_sec;
+    e->ctime = stx->stx_ctime.tv_sec;
+    e->nlink = stx->stx_nlink;
+    e->size = stx->stx_size;
+    if (e->d_type == DT_UNKNOWN) {
+        e->d_type = IFTODT(stx->stx_mode);
+    }
+}
+
+static void stat_one(dir_scan_t *sc, dir_entry_t *e, unsigned mask)
+{
+    struct statx stx;
+
+    if (statx(sc->fd, e->name, DIRSCAN_STATX_FLAGS, mask, &stx) == 0) {
+        apply_statx(e, &stx);
+    }
+}
+
+/* 작업에서 항목을 하나씩 가져가며 statx 한다 */
+static void stat_job_run(stat_job_t *job)
+{
+    int i;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+        stat_one(job->sc, &job->ent[i], job->mask);
+    }
+}
+
+static void *pool_worker(void *arg)
+{
+    unsigned seen = 0;
+
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.generation == seen) {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        seen = pool.generation;
+        stat_job_t *job = pool.job;
+        if (job == NULL) {
+            pthread_mutex_unlock(&pool.lock);
+            continue;
+        }
+        pool.active++;
+        pthread_mutex_unlock(&pool.lock);
+
+        stat_job_run(job);
+
+        // job 은 요청한 스레드의 스택에 있으므로 다 쓴 뒤에 알린다
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.active == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+static int pool_start(void)
+{
+    pthread_t tid;
+
+    for (int i = 0; i < POOL_THREADS; i++) {
+        if (pthread_create(&tid, NULL, pool_worker, NULL) != 0) {
+            return i > 0 ? 0 : -1;
+        }
+        pthread_detach(tid);
+    }
+    return 0;
+}
+
+static void stat_threads(dir_scan_t *sc, dir_entry_t **todo, int n, unsigned mask)
+{
+    // 풀은 연속된 배열을 나눠 가지므로 항목을 잠시 모아서 처리
+    dir_entry_t *ent = malloc(sizeof(dir_entry_t) * n);
+    if (ent == NULL) {
+        for (int i = 0; i < n; i++) stat_one(sc, todo[i], mask);
+        return;
+    }
+    for (int i = 0; i < n; i++) ent[i] = *todo[i];
+
+    stat_job_t job = { .sc = sc, .ent = ent, .count = n, .mask = mask, .next = 0 };
+
+    pthread_mutex_lock(&pool.busy);
+    pthread_mutex_lock(&pool.lock);
+    pool.job = &job;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    // 요청한 스레드도 같이 처리. 돌아오면 모든 항목이 누군가에게 할당된 상태
+    stat_job_run(&job);
+
+    pthread_mutex_lock(&pool.lock);
+    pool.job = NULL;
+    while (pool.active > 0) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.busy);
+
+    for (int i = 0; i < n; i++) *todo[i] = ent[i];
+    free(ent);
+}
+
+/* 완료된 CQE 를 거둔다. 완료 순서는 제출 순서와 다르므로 user_data (todo 의 인덱스) 로 표시한다 */
+static int uring_reap(dir_scan_t *sc, dir_entry_t **todo, unsigned mask, char *finished)
+{
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    int reaped = 0;
+
+    for (; head != tail; head++, reaped++) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        int i = (int)cqe->user_data;
+
+        if (cqe->res == 0) {
+            apply_statx(todo[i], &sc->stx[i]);
+        } else if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+            stat_one(sc, todo[i], mask); // IORING_OP_STATX 를 모르는 커널
+        }
+        finished[i] = 1;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+/* 링이 망가졌을 때: 아직 커널이 가져가지 않은 SQE 는 되돌리고, 가져간 것은 stx 에 쓰기를
+ * 끝낼 때까지 기다린 뒤, 끝나지 않은 항목만 직접 처리한다. 이후로는 스레드 풀 사용 */
+static void uring_abort(dir_scan_t *sc, dir_entry_t **todo, int n, unsigned mask, char *finished, int inflight)
+{
+    unsigned sq_head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+
+    inflight -= *ring.sq_tail - sq_head;
+    __atomic_store_n(ring.sq_tail, sq_head, __ATOMIC_RELEASE);
+
+    while ((inflight -= uring_reap(sc, todo, mask, finished)) > 0) {
+        if (syscall(__NR_io_uring_enter, ring.fd, 0, inflight, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR) {
+            // 기다릴 수도 없으면 커널이 나중에 쓸 수 있는 stx 는 놓지 않는다
+            sc->stx = NULL;
+            break;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!finished[i]) stat_one(sc, todo[i], mask);
+    }
+    backend = pool_start() == 0 ? STAT_THREADS : STAT_SERIAL;
+}
+
+/* 배치 전체의 statx 를 한꺼번에 제출하고 완료되는 순서대로 받는다 */
+static void stat_uring(dir_scan_t *sc, dir_entry_t **todo, int n, unsigned mask)
+{
+    char finished[DIRSCAN_BATCH];
+    int next = 0, inflight = 0, done = 0;  // inflight: 링에 넣었지만 아직 완료되지 않은 수 (제출 전 포함)
+
+    memset(finished, 0, n);
+    while (done < n) {
+        while (next < n && inflight < URING_DEPTH) {
+            uring_push_statx(&ring, sc->fd, todo[next]->name, mask, &sc->stx[next], next);
+            next++;
+            inflight++;
+        }
+
+        // EINTR 이나 일부만 제출된 경우에도 남은 SQE 는 다음 호출에서 다시 제출한다
+        unsigned to_submit = *ring.sq_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR) {
+            perror("io_uring_enter");
+            uring_abort(sc, todo, n, mask, finished, inflight);
+            return;
+        }
+
+        int reaped = uring_reap(sc, todo, mask, finished);
+        inflight -= reaped;
+        done += reaped;
+    }
+}
+
+/* 사용할 statx 방식을 고른다. MYSH_STAT_BACKEND=uring|threads|serial 로 강제할 수 있다 */
+void dirscan_init(void)
+{
+    const char *want = getenv("MYSH_STAT_BACKEND");
+
+    if (want && strcmp(want, "serial") == 0) {
+        backend = STAT_SERIAL;
+    } else if ((!want || strcmp(want, "uring") == 0) && uring_setup(&ring, URING_DEPTH) == 0) {
+        backend = STAT_URING;
+    } else {
+        backend = pool_start() == 0 ? STAT_THREADS : STAT_SERIAL;
+    }
+
+    printf("stat backend: %s\n", backend == STAT_URING ? "io_uring" :
+                                 backend == STAT_THREADS ? "threads" : "serial");
+}
+
+/* (dfd, path) 디렉토리 스캔을 시작한다 */
+int dirscan_open(dir_scan_t *sc, int dfd, const char *path, int what)
+{
+    memset(sc, 0, sizeof(*sc));
+
+    sc->fd = openat(dfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (sc->fd < 0) {
+        return -1;
+    }
+
+    sc->buf = malloc(DIRSCAN_BUF_SIZE);
+    sc->stx = malloc(sizeof(struct statx) * DIRSCAN_BATCH);
+    if (sc->buf == NULL || sc->stx == NULL) {
+        free(sc->buf);
+        free(sc->stx);
+        close(sc->fd);
+        sc->fd = -1;
+        return -1;
+    }
+
+    sc->what = what;
+    return 0;
+}
+
+/* 필요한 항목을 한꺼번에 statx */
+static void stat_batch(dir_scan_t *sc, dir_entry_t **todo, int n, unsigned mask)
+{
+    if (n < PARALLEL_MIN || backend == STAT_SERIAL) {
+        for (int i = 0; i < n; i++) stat_one(sc, todo[i], mask);
+    } else if (backend == STAT_URING) {
+        stat_uring(sc, todo, n, mask);
+    } else {
+        stat_threads(sc, todo, n, mask);
+    }
+}
+
+/* 심볼릭 링크 대상을 pool 에 읽어 둔다 */
+static void read_links(dir_scan_t *sc, dir_batch_t *batch)
+{
+    batch->pool_len = 0;
+    for (int i = 0; i < batch->count; i++) {
+        dir_entry_t *e = &batch->ent[i];
+        if (!S_ISLNK(e->mode)) {
+            continue;
+        }
+
+        char *dst = batch->pool + batch->pool_len;
+        ssize_t len = readlinkat(sc->fd, e->name, dst, DIRSCAN_LINK_MAX - 1);
+        if (len != -1) {
+            dst[len] = '\0';
+            e->link = dst;
+            batch->pool_len += len + 1;
+        }
+    }
+}
+
+/* 다음 항목들을 batch 에 채운다. 채운 항목 수, 끝이면 0, 오류면 -1 */
+int dirscan_next(dir_scan_t *sc, dir_batch_t *batch)
+{
+    dir_entry_t *todo[DIRSCAN_BATCH];
+    int ntodo = 0;
+    unsigned mask = sc->what == DIRSCAN_STAT ? DIRSCAN_STATX_MASK : STATX_TYPE;
+
+    batch->count = 0;
+    batch->pool_len = 0;
+
+    // 1. getdents64 레코드에서 이름과 타입을 채운다
+    while (batch->count < DIRSCAN_BATCH) {
+        // 버퍼를 다 썼으면 커널에서 한 번에 많이 읽어 온다
+        if (sc->pos >= sc->len) {
+            if (sc->eof) {
+                break;
+            }
+
+            long n = syscall(SYS_getdents64, sc->fd, sc->buf, DIRSCAN_BUF_SIZE);
+            if (n < 0) {
+                if (batch->count == 0) return -1;
+                break;
+            }
+            if (n == 0) {
+                sc->eof = 1;
+                break;
+            }
+            sc->len = n;
+            sc->pos = 0;
+        }
+
+        struct linux_dirent64 *d = (struct linux_dirent64 *)(sc->buf + sc->pos);
+        dir_entry_t *e = &batch->ent[batch->count++];
+
+        sc->pos += d->d_reclen;
+
+        memset(e, 0, offsetof(dir_entry_t, name));
+        e->ino = d->d_ino;
+        e->d_type = d->d_type;
+        snprintf(e->name, sizeof(e->name), "%s", d->d_name);
+
+        // 이름만 필요하면 d_type 을 모를 때만 stat
+        if (sc->what == DIRSCAN_STAT || e->d_type == DT_UNKNOWN) {
+            todo[ntodo++] = e;
+        }
+    }
+
+    // 2. 필요한 항목을 한꺼번에 statx 하고 링크 대상을 읽는다
+    stat_batch(sc, todo, ntodo, mask);
+    if (sc->what == DIRSCAN_STAT) {
+        read_links(sc, batch);
+    }
+
+    return batch->count;
+}
+
+/* 이름 (과 ino, d_type) 만 채워진 batch 항목들의 메타데이터를 스캔 중인 디렉토리에서 채운다.
+ * 정렬처럼 이름을 먼저 다 모은 뒤 일부만 자세히 보여줄 때 쓴다 */
+void dirscan_fill(dir_scan_t *sc, dir_batch_t *batch)
+{
+    dir_entry_t *todo[DIRSCAN_BATCH];
+
+    for (int i = 0; i < batch->count; i++) {
+        todo[i] = &batch->ent[i];
+    }
+    stat_batch(sc, todo, batch->count, DIRSCAN_STATX_MASK);
+    read_links(sc, batch);
+}
+
+/* dfd 디렉토리의 name 항목 하나를 stat 한다 (ino 포함). 심볼릭 링크면 대상을 link 에 읽는다 */
+int dirscan_stat(int dfd, const char *name, dir_entry_t *e, char *link, size_t size)
+{
+    struct statx stx;
+
+    memset(e, 0, offsetof(dir_entry_t, name));
+    if (statx(dfd, name, DIRSCAN_STATX_FLAGS, DIRSCAN_STATX_MASK | STATX_INO, &stx) < 0) {
+        return -1;
+    }
+
+    e->ino = stx.stx_ino;
+    e->d_type = DT_UNKNOWN;
+    apply_statx(e, &stx);
+    snprintf(e->name, sizeof(e->name), "%s", name);
+
+    if (S_ISLNK(e->mode) && link != NULL) {
+        ssize_t len = readlinkat(dfd, name, link, size - 1);
+        if (len != -1) {
+            link[len] = '\0';
+            e->link = link;
+        }
+    }
+    return 0;
+}
+
+void dirscan_close(dir_scan_t *sc)
+{
+    if (sc->fd >= 0) {
+        close(sc->fd);
+        sc->fd = -1;
+    }
+    free(sc->buf);
+    free(sc->stx);
+    sc->buf = NULL;
+    sc->stx = NULL;
+}
@@ -0,0 +1,61 @@
+#ifndef MYSH_DIRSCAN_H
+#define MYSH_DIRSCAN_H
+
+#include <stdint.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+#define DIRSCAN_BATCH       (256)           // 한 번에 채우는 항목 수
+#define DIRSCAN_LINK_MAX    (1024)
+#define DIRSCAN_POOL_SIZE   (DIRSCAN_BATCH * DIRSCAN_LINK_MAX) // 심볼릭 링크 대상 경로 저장 공간
+#define DIRSCAN_BUF_SIZE    (256 * 1024)    // getdents64 버퍼
+
+/* 스캔할 때 필요한 정보 */
+#define DIRSCAN_NAMES       (0)     // 이름과 타입만 (d_type 이 있으면 stat 생략)
+#define DIRSCAN_STAT        (1)     // 목록 프로토콜이 보내는 메타데이터 전부
+
+/* 디렉토리 항목 하나의 메타데이터 */
+typedef struct dir_entry {
+    uint64_t    ino;
+    uint8_t     d_type;
+    mode_t      mode;
+    uid_t       uid;
+    gid_t       gid;
+    int64_t     atime;
+    int64_t     mtime;
+    int64_t     ctime;
+    uint32_t    nlink;
+    int64_t     size;
+    const char *link;               // 심볼릭 링크 대상 (pool 안), 아니면 NULL
+    char        name[NAME_MAX + 1];
+} dir_entry_t;
+
+/* 스캔 한 번에 채워지는 항목 테이블 */
+typedef struct dir_batch {
+    int         count;
+    dir_entry_t ent[DIRSCAN_BATCH];
+    size_t      pool_len;
+    char        pool[DIRSCAN_POOL_SIZE];
+} dir_batch_t;
+
+struct statx;
+
+typedef struct dir_scan {
+    int         fd;
+    int         what;               // DIRSCAN_NAMES / DIRSCAN_STAT
+    int         eof;
+    char       *buf;                // getdents64 로 읽은 원본 레코드
+    size_t      len;
+    size_t      pos;
+    struct statx *stx;              // io_uring statx 결과 버퍼 (DIRSCAN_BATCH 개)
+} dir_scan_t;
+
+void dirscan_init(void);
+int  dirscan_open(dir_scan_t *sc, int dfd, const char *path, int what);
+int  dirscan_next(dir_scan_t *sc, dir_batch_t *batch);
+void dirscan_fill(dir_scan_t *sc, dir_batch_t *batch);
+int  dirscan_stat(int dfd, const char *name, dir_entry_t *e, char *link, size_t size);
+void dirscan_close(dir_scan_t *sc);
+
+#endif // MYSH_DIRSCAN_H
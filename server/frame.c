@@ -0,0 +1,48 @@
+#include <string.h>
+#include <arpa/inet.h>
+#include "frame.h"
+
+void frame_encode_header(char *hdr, uint8_t type, uint8_t flags, uint32_t id, uint32_t length)
+{
+    uint32_t nid = htonl(id);
+    uint32_t nlen = htonl(length);
+
+    hdr[0] = FRAME_MAGIC;
+    hdr[1] = FRAME_VERSION;
+    hdr[2] = type;
+    hdr[3] = flags;
+    memcpy(hdr + 4, &nid, 4);
+    memcpy(hdr + 8, &nlen, 4);
+}
+
+/* buf 앞부분에서 프레임 하나를 꺼낸다.
+ * 사용한 바이트 수, 아직 덜 받았으면 0, 잘못된 프레임이면 -1 을 반환 */
+int frame_decode(const char *buf, size_t len, size_t max_payload, frame_t *frame)
+{
+    uint32_t nid, nlen;
+
+    if (len < FRAME_HDR_SIZE) {
+        return 0;
+    }
+
+    if ((uint8_t)buf[0] != FRAME_MAGIC || (uint8_t)buf[1] != FRAME_VERSION) {
+        return -1;
+    }
+
+    memcpy(&nid, buf + 4, 4);
+    memcpy(&nlen, buf + 8, 4);
+    frame->type = buf[2];
+    frame->flags = buf[3];
+    frame->id = ntohl(nid);
+    frame->length = ntohl(nlen);
+    frame->payload = buf + FRAME_HDR_SIZE;
+
+    if (frame->length > max_payload) {
+        return -1;
+    }
+    if (len < FRAME_HDR_SIZE + (size_t)frame->length) {
+        return 0;
+    }
+
+    return FRAME_HDR_SIZE + frame->length;
+}
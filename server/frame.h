@@ -0,0 +1,83 @@
+#ifndef MYSH_FRAME_H
+#define MYSH_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 클라이언트-서버 사이의 프레임 형식 (모든 정수는 network byte order)
+ *
+ *   +-------+---------+------+-------+------------+--------+---------+
+ *   | magic | version | type | flags | request id | length | payload |
+ *   |  1B   |   1B    |  1B  |  1B   |     4B     |   4B   | length  |
+ *   +-------+---------+------+-------+------------+--------+---------+
+ *
+ * 요청 하나에 대한 응답은 0개 이상의 데이터 프레임과 마지막 FT_END 프레임
+ * (payload: int32 반환 값)으로 이루어진다. 같은 타입의 데이터 프레임이
+ * 여러 개 오면 이어 붙여서 하나의 응답으로 본다.
+ *
+ * request id 0 은 요청 없이 서버가 먼저 보내는 응답이다 (감시 중인 디렉토리의
+ * FT_DELTA/FT_VERSION, FT_NOTIFY, 백그라운드 작업의 FT_JOB). 이것도 FT_END 로 끝난다.
+ */
+#define FRAME_MAGIC         (0x4D)      // 'M'
+#define FRAME_VERSION       (1)
+#define FRAME_HDR_SIZE      (12)
+#define FRAME_MAX_PAYLOAD   (16 * 1024 * 1024)
+
+enum frame_type {
+    FT_REQUEST      = 0x01,     // client -> server: 명령어 한 줄
+
+    FT_PATH         = 0x10,     // 현재 작업 디렉토리
+    FT_LISTING      = 0x11,     // 디렉토리 목록 (한 줄에 한 항목)
+    FT_FILE_INFO    = 0x12,     // 파일 내용 앞에 오는 파일 정보 (uint64 파일 크기, 구간 시작,
+                                //   첫 줄 번호, 전체 줄 수 + 경로. 모르는 값은 UINT64_MAX)
+    FT_FILE         = 0x13,     // 파일 내용
+    FT_PROCS        = 0x14,     // 프로세스 목록
+    FT_NAMES        = 0x15,     // 이름만 있는 디렉토리 목록 ("<타입> <이름>" 한 줄씩)
+    FT_WINDOW       = 0x16,     // 정렬된 목록의 구간 정보 (uint32 offset, count, total)
+    FT_DELTA        = 0x17,     // 현재 디렉토리 변경분 ("+ <목록 한 줄>", "~ <목록 한 줄>", "- <이름>")
+    FT_VERSION      = 0x18,     // 디렉토리 스냅샷 버전 (uint32 이전 버전, 새 버전). 전체 목록이면 이전 버전 0
+    FT_NOTIFY       = 0x19,     // 감시 중인 대상이 바뀜 (uint8 NOTIFY_* 비트, request id 0 으로 먼저 보냄)
+    FT_RECORDS      = 0x1A,     // FT_LISTING 의 바이너리 형식 ("format binary" 세션, 아래 참고)
+    FT_JOB          = 0x1B,     // 백그라운드 작업 상태 (아래 참고). 진행 상황은 request id 0 으로 온다
+    FT_TRASH        = 0x1C,     // 휴지통 항목 ("<id> <지운 시각(유닉스 초)> <원래 경로>" 한 줄씩. rm -t, trash)
+    FT_STATS        = 0x1D,     // 서버 통계 ("<이름> <값>" 한 줄씩. cache)
+    FT_ERROR        = 0x1E,     // 오류 메시지
+    FT_END          = 0x1F,     // 응답 끝, payload 는 int32 반환 값
+};
+
+/*
+ * FT_RECORDS payload (이것만 little-endian)
+ *
+ *   uint32 개수 n, uint32 문자열 기준 위치 base, 레코드 n 개, 문자열 테이블
+ *
+ * 레코드 (48B): uint64 ino, uint64 size, int64 mtime, uint32 name_off, uint16 name_len,
+ *               uint16 link_len, uint32 st_mode (파일 타입 비트 포함), uint32 uid, gid, nlink
+ *
+ * 이름은 문자열 테이블의 name_off - base 위치에 있고 (NUL 없음), 심볼릭 링크 대상은
+ * 이름 바로 뒤에 link_len 바이트. 문자열은 레코드 순서대로 붙어 있으므로 테이블 길이는
+ * name_len + link_len 의 합이다. 같은 응답의 FT_RECORDS 는 이어 붙여도 차례로 읽을 수 있다.
+ */
+#define FRAME_RECORD_SIZE   (48)
+
+/*
+ * FT_JOB payload: 고정 헤더 64B 뒤에 명령 문자열 (NUL 없음). 여러 개를 이어 붙여도 된다 (jobs)
+ *
+ *   uint32 job id, uint8 상태 (0 실행 중, 1 끝남, 2 취소됨), 3B 0, int32 반환 값 (끝났을 때),
+ *   uint32 경과 ms, uint64 끝난 파일 수, 전체 파일 수, 처리한 바이트, 전체 바이트 (전체가 0 이면 모름),
+ *   uint64 초당 바이트, uint32 남은 초 (0xFFFFFFFF 이면 모름), uint32 명령 문자열 길이
+ */
+#define FRAME_JOB_SIZE      (64)
+
+typedef struct frame {
+    uint8_t     type;
+    uint8_t     flags;
+    uint32_t    id;
+    uint32_t    length;
+    const char *payload;        // 디코딩한 버퍼 안을 가리킴
+} frame_t;
+
+void frame_encode_header(char *hdr, uint8_t type, uint8_t flags, uint32_t id, uint32_t length);
+int  frame_decode(const char *buf, size_t len, size_t max_payload, frame_t *frame);
+
+#endif // MYSH_FRAME_H
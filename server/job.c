@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "job.h"
+#include "frame.h"
+
+static job_t   *jobs;               // 최근 것이 앞
+static uint32_t next_id = 1;
+static int      event_fd = -1;
+static int      timer_fd = -1;
+static int      timer_armed;
+
+int job_init(void)
+{
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (event_fd < 0 || timer_fd < 0) {
+        perror("job eventfd/timerfd");
+        return -1;
+    }
+    return 0;
+}
+
+int job_event_fd(void)
+{
+    return event_fd;
+}
+
+int job_timer_fd(void)
+{
+    return timer_fd;
+}
+
+/* 실행 중이거나 아직 결과를 못 보낸 작업이 있는 동안만 주기적으로 깨어난다 */
+static void timer_set(int on)
+{
+    struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+
+    if (on == timer_armed) {
+        return;
+    }
+    if (on) {
+        its.it_value.tv_nsec = its.it_interval.tv_nsec = JOB_PROGRESS_MS * 1000000L;
+    }
+    if (timerfd_settime(timer_fd, 0, &its, NULL) == 0) {
+        timer_armed = on;
+    }
+}
+
+static void *job_main(void *arg)
+{
+    job_t   *job = arg;
+    uint64_t one = 1;
+
+    job->status = job->run(job);
+    clock_gettime(CLOCK_MONOTONIC, &job->end);
+    __atomic_store_n(&job->state, __atomic_load_n(&job->cancel, __ATOMIC_RELAXED) ? JOB_CANCELLED : JOB_DONE,
+                     __ATOMIC_RELEASE);
+
+    // 이벤트 루프를 깨워서 결과를 보내게 한다
+    if (write(event_fd, &one, sizeof(one)) < 0) {
+        perror("write eventfd");
+    }
+    return NULL;
+}
+
+job_t *job_start(const char *desc, int (*run)(job_t *), void (*finish)(job_t *),
+                 void (*stop)(job_t *), void (*release)(void *), void *arg)
+{
+    job_t *job = calloc(1, sizeof(job_t));
+
+    if (job == NULL || event_fd < 0) {
+        free(job);
+        return NULL;
+    }
+
+    job->id = next_id++;
+    snprintf(job->desc, sizeof(job->desc), "%s", desc);
+    job->owner = cur_session;
+    job->run = run;
+    job->finish = finish;
+    job->stop = stop;
+    job->release = release;
+    job->arg = arg;
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+    int err = pthread_create(&job->tid, NULL, job_main, job);
+    if (err != 0) {
+        free(job);
+        errno = err;
+        return NULL;
+    }
+
+    job->next = jobs;
+    jobs = job;
+    timer_set(1);
+    return job;
+}
+
+void job_progress(void *arg, uint64_t files, uint64_t bytes)
+{
+    job_t *job = arg;
+
+    if (files) {
+        __atomic_add_fetch(&job->files_done, files, __ATOMIC_RELAXED);
+    }
+    if (bytes) {
+        __atomic_add_fetch(&job->bytes_done, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+void job_set_total(job_t *job, uint64_t files, uint64_t bytes)
+{
+    __atomic_store_n(&job->files_total, files, __ATOMIC_RELAXED);
+    __atomic_store_n(&job->bytes_total, bytes, __ATOMIC_RELAXED);
+}
+
+static uint64_t elapsed_ms(const job_t *job, int state)
+{
+    struct timespec now;
+
+    if (state == JOB_RUNNING) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } else {
+        now = job->end;
+    }
+    return (uint64_t)(now.tv_sec - job->start.tv_sec) * 1000 + (now.tv_nsec - job->start.tv_nsec) / 1000000;
+}
+
+/* 지금까지의 속도로 남은 시간 (초). 바이트와 파일 수 중 더 오래 걸리는 쪽. 모르면 UINT32_MAX */
+static uint32_t eta_seconds(uint64_t ms, uint64_t files, uint64_t files_total, uint64_t bytes, uint64_t bytes_total)
+{
+    double eta = -1;
+
+    if (bytes > 0 && bytes_total >= bytes) {
+        eta = (double)(bytes_total - bytes) * ms / bytes / 1000;
+    }
+    if (files > 0 && files_total >= files) {
+        double by_files = (double)(files_total - files) * ms / files / 1000;
+        eta = by_files > eta ? by_files : eta;
+    }
+    return eta < 0 || eta >= UINT32_MAX ? UINT32_MAX : (uint32_t)(eta + 0.5);
+}
+
+/* FT_JOB 하나 (형식은 frame.h) */
+int job_send(const job_t *job)
+{
+    char     buf[FRAME_JOB_SIZE + JOB_DESC_SIZE];
+    int      state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+    uint64_t ms = elapsed_ms(job, state);
+    uint64_t files = __atomic_load_n(&job->files_done, __ATOMIC_RELAXED);
+    uint64_t bytes = __atomic_load_n(&job->bytes_done, __ATOMIC_RELAXED);
+    uint64_t files_total = __atomic_load_n(&job->files_total, __ATOMIC_RELAXED);
+    uint64_t bytes_total = __atomic_load_n(&job->bytes_total, __ATOMIC_RELAXED);
+    uint32_t desc_len = strlen(job->desc);
+    uint32_t u32;
+    int32_t  i32;
+    uint64_t u64;
+
+    memset(buf, 0, FRAME_JOB_SIZE);
+    u32 = htonl(job->id);                           memcpy(buf, &u32, 4);
+    buf[4] = (char)state;
+    i32 = htonl(state == JOB_RUNNING ? 0 : job->status); memcpy(buf + 8, &i32, 4);
+    u32 = htonl(ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms); memcpy(buf + 12, &u32, 4);
+    u64 = htobe64(files);                           memcpy(buf + 16, &u64, 8);
+    u64 = htobe64(files_total);                     memcpy(buf + 24, &u64, 8);
+    u64 = htobe64(bytes);                           memcpy(buf + 32, &u64, 8);
+    u64 = htobe64(bytes_total);                     memcpy(buf + 40, &u64, 8);
+    u64 = htobe64(ms > 0 ? bytes * 1000 / ms : 0);  memcpy(buf + 48, &u64, 8);
+    u32 = htonl(state == JOB_RUNNING ? eta_seconds(ms, files, files_total, bytes, bytes_total) : 0);
+    memcpy(buf + 56, &u32, 4);
+    u32 = htonl(desc_len);                          memcpy(buf + 60, &u32, 4);
+    memcpy(buf + FRAME_JOB_SIZE, job->desc, desc_len);
+
+    return send_frame(FT_JOB, buf, FRAME_JOB_SIZE + desc_len);
+}
+
+int job_send_all(void)
+{
+    for (job_t *job = jobs; job; job = job->next) {
+        if (job_send(job) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+job_t *job_find(uint32_t id)
+{
+    for (job_t *job = jobs; job; job = job->next) {
+        if (job->id == id) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+int job_cancel(job_t *job)
+{
+    if (__atomic_load_n(&job->state, __ATOMIC_ACQUIRE) != JOB_RUNNING) {
+        return -1;
+    }
+    __atomic_store_n(&job->cancel, 1, __ATOMIC_RELAXED);
+    if (job->stop) {
+        job->stop(job);
+    }
+    return 0;
+}
+
+void job_forget(session_t *s)
+{
+    for (job_t *job = jobs; job; job = job->next) {
+        if (job->owner == s) {
+            job->owner = NULL;
+        }
+    }
+}
+
+/* 응답을 스트리밍하는 중인 세션에는 순서가 섞이지 않게 다음 타이머로 미룬다 */
+static int owner_busy(const session_t *s)
+{
+    return s->producer || s->sf_left > 0 || s->ref_left > 0;
+}
+
+/* owner 에게 request id 0 응답으로 보낸다. 끝난 작업이면 finish 의 변경분도 같이 */
+static void push(job_t *job, int final)
+{
+    session_t *s = job->owner;
+    uint32_t saved_id = s ? s->req_id : 0;
+    int32_t status = htonl(0);
+
+    cur_session = s;
+    if (s) {
+        s->req_id = 0;
+    }
+    if (final && job->finish) {
+        job->finish(job);
+    }
+    if (s) {
+        job->sent_files = __atomic_load_n(&job->files_done, __ATOMIC_RELAXED);
+        job->sent_bytes = __atomic_load_n(&job->bytes_done, __ATOMIC_RELAXED);
+        job_send(job);
+        send_frame(FT_END, &status, sizeof(status));
+        s->req_id = saved_id;
+    }
+    cur_session = NULL;
+}
+
+static void job_free(job_t *job)
+{
+    if (job->release) {
+        job->release(job->arg);
+    }
+    free(job);
+}
+
+/* 끝난 작업의 결과를 보내고, 오래된 것은 JOB_KEEP_DONE 개만 남긴다.
+ * 아직 실행 중이거나 못 보낸 작업이 있으면 1 */
+static int job_poll(int progress)
+{
+    int active = 0, kept = 0;
+
+    for (job_t **pp = &jobs; *pp; ) {
+        job_t *job = *pp;
+        int state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+
+        if (state == JOB_RUNNING) {
+            if (progress && job->owner && !owner_busy(job->owner) &&
+                (__atomic_load_n(&job->files_done, __ATOMIC_RELAXED) != job->sent_files ||
+                 __atomic_load_n(&job->bytes_done, __ATOMIC_RELAXED) != job->sent_bytes)) {
+                push(job, 0);
+            }
+            active = 1;
+        } else if (!job->reported) {
+            if (job->owner && owner_busy(job->owner)) {
+                active = 1;
+            } else {
+                pthread_join(job->tid, NULL);
+                push(job, 1);
+                job->reported = 1;
+            }
+        }
+
+        if (job->reported && ++kept > JOB_KEEP_DONE) {
+            *pp = job->next;
+            job_free(job);
+            continue;
+        }
+        pp = &job->next;
+    }
+    return active;
+}
+
+void job_handle_event(void)
+{
+    uint64_t count;
+
+    if (read(event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("read eventfd");
+    }
+    timer_set(job_poll(0));
+}
+
+void job_handle_timer(void)
+{
+    uint64_t expirations;
+
+    if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        perror("read timerfd");
+    }
+    timer_set(job_poll(1));
+}
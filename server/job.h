@@ -0,0 +1,65 @@
+#ifndef MYSH_JOB_H
+#define MYSH_JOB_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include "mysh.h"
+
+#define JOB_PROGRESS_MS     (250)   // 실행 중인 작업의 진행 상황을 보내는 간격
+#define JOB_KEEP_DONE       (32)    // 끝난 작업을 jobs 로 볼 수 있게 남겨 두는 개수
+#define JOB_DESC_SIZE       (256)
+
+/* FT_JOB 의 상태 값 */
+enum job_state {
+    JOB_RUNNING     = 0,
+    JOB_DONE        = 1,    // 끝남 (status 가 0 이 아니면 일부 실패)
+    JOB_CANCELLED   = 2,
+};
+
+/* 명령 하나를 스레드에서 실행하는 백그라운드 작업.
+ * 진행 상황 (files, bytes) 은 작업 스레드가 원자적으로 늘리고, 보내는 것은 이벤트 루프가 한다 */
+typedef struct job {
+    uint32_t    id;
+    char        desc[JOB_DESC_SIZE];    // 실행한 명령 ("cp -r a b")
+    session_t  *owner;          // 진행 상황을 받을 세션 (닫히면 NULL, 작업은 계속)
+    int         state;          // JOB_* (원자적)
+    int         cancel;         // 취소 요청 (원자적. copy_ctl_t.cancel 로 넘긴다)
+    int32_t     status;         // run 의 반환 값
+    uint64_t    files_done;     // 원자적
+    uint64_t    bytes_done;
+    uint64_t    files_total;    // 0 이면 아직 모름
+    uint64_t    bytes_total;
+    struct timespec start;
+    struct timespec end;
+    int         reported;       // 끝난 결과를 owner 에게 보냈음 (이벤트 루프에서만)
+    uint64_t    sent_files;     // 마지막으로 보낸 진행 상황
+    uint64_t    sent_bytes;
+
+    int       (*run)(struct job *job);      // 작업 스레드에서
+    void      (*finish)(struct job *job);   // 끝난 뒤 이벤트 루프에서 (cur_session 은 owner, id 0 응답)
+    void      (*stop)(struct job *job);     // 취소할 때 이벤트 루프에서 (없으면 cancel 만 세운다)
+    void      (*release)(void *arg);
+    void       *arg;
+    pthread_t   tid;
+    struct job *next;
+} job_t;
+
+int  job_init(void);
+int  job_event_fd(void);                        // 작업이 끝나면 읽을 수 있게 된다 (eventfd)
+int  job_timer_fd(void);                        // 작업이 실행 중인 동안 JOB_PROGRESS_MS 마다
+
+/* cur_session 을 owner 로 하는 작업을 시작한다. 시작하지 못하면 NULL (arg 는 호출한 쪽이 정리) */
+job_t *job_start(const char *desc, int (*run)(job_t *), void (*finish)(job_t *),
+                 void (*stop)(job_t *), void (*release)(void *), void *arg);
+void job_progress(void *job, uint64_t files, uint64_t bytes); // copy_ctl_t.progress 로도 쓴다
+void job_set_total(job_t *job, uint64_t files, uint64_t bytes);
+int  job_send(const job_t *job);                 // 현재 응답에 FT_JOB 하나
+int  job_send_all(void);                         // 모든 작업 (최근 것부터)
+job_t *job_find(uint32_t id);
+int  job_cancel(job_t *job);                     // 이미 끝났으면 -1
+void job_forget(session_t *s);
+void job_handle_event(void);
+void job_handle_timer(void);
+
+#endif // MYSH_JOB_H
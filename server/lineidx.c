@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "lineidx.h"
+
+#define SCAN_BUF_SIZE       (256 * 1024)
+
+static line_index_t cache[LINEIDX_CACHE_SIZE];
+static uint64_t use_clock;
+
+static void index_reset(line_index_t *ix, const struct stat *st)
+{
+    ix->dev = st->st_dev;
+    ix->ino = st->st_ino;
+    ix->mtime = st->st_mtim;
+    ix->size = st->st_size;
+    ix->nmarks = 0;
+    ix->scanned_off = 0;
+    ix->scanned_line = 0;
+    ix->complete = st->st_size == 0;
+}
+
+static int add_mark(line_index_t *ix, uint64_t off, uint64_t line)
+{
+    if (ix->nmarks == ix->cap) {
+        size_t cap = ix->cap ? ix->cap * 2 : 64;
+        line_mark_t *p = realloc(ix->marks, sizeof(line_mark_t) * cap);
+        if (p == NULL) {
+            return -1;
+        }
+        ix->marks = p;
+        ix->cap = cap;
+    }
+
+    ix->marks[ix->nmarks].off = off;
+    ix->marks[ix->nmarks].line = line;
+    ix->nmarks++;
+    return 0;
+}
+
+static int same_file(const line_index_t *ix, const struct stat *st)
+{
+    return ix->marks && ix->dev == st->st_dev && ix->ino == st->st_ino;
+}
+
+/* st 파일의 인덱스를 잡아서 돌려준다 (다 쓰면 lineidx_put).
+ * mtime/크기가 같은 것이 없으면 잡혀 있지 않은 자리에서 새로 만든다. 다른 요청이 잡고 있는
+ * 인덱스는 파일이 바뀌었어도 지우지 않는다 (그 요청은 스스로 ESTALE 로 끝난다).
+ * 모든 자리가 잡혀 있으면 이 요청만 쓰는 인덱스를 따로 만든다 */
+line_index_t *lineidx_get(const struct stat *st)
+{
+    line_index_t *ix = NULL, *victim = NULL;
+
+    for (int i = 0; i < LINEIDX_CACHE_SIZE; i++) {
+        line_index_t *c = &cache[i];
+
+        if (same_file(c, st) && c->size == st->st_size && c->mtime.tv_sec == st->st_mtim.tv_sec &&
+            c->mtime.tv_nsec == st->st_mtim.tv_nsec) {
+            ix = c;
+            break;
+        }
+        if (c->refs > 0) {
+            continue;
+        }
+        // 같은 파일의 예전 인덱스, 없으면 가장 오래 안 쓴 자리
+        if (victim == NULL || (same_file(c, st) && !same_file(victim, st)) ||
+            (same_file(c, st) == same_file(victim, st) && c->last_used < victim->last_used)) {
+            victim = c;
+        }
+    }
+
+    if (ix == NULL) {
+        ix = victim ? victim : calloc(1, sizeof(line_index_t));
+        if (ix == NULL) {
+            return NULL;
+        }
+        ix->priv = victim == NULL;
+        index_reset(ix, st);
+    }
+
+    if (ix->nmarks == 0 && add_mark(ix, 0, 0) < 0) {
+        if (ix->priv) free(ix);
+        return NULL;
+    }
+
+    ix->refs++;
+    ix->last_used = ++use_clock;
+    return ix;
+}
+
+void lineidx_put(line_index_t *ix)
+{
+    if (ix != NULL && --ix->refs == 0 && ix->priv) {
+        free(ix->marks);
+        free(ix);
+    }
+}
+
+/* from 위치 (from_line 번째 줄 시작) 부터 target 번째 줄의 시작까지 읽어 나간다.
+ * extend 이면 스캔하면서 인덱스를 늘린다. 파일 끝에 닿으면 파일 크기를 돌려준다.
+ * limit 바이트 넘게 읽으면 마지막으로 본 줄 시작에서 멈추고 1 을 돌려준다 (extend 일 때만) */
+static int scan_lines(line_index_t *ix, int fd, uint64_t from, uint64_t from_line,
+                      uint64_t target, int extend, uint64_t limit, uint64_t *off)
+{
+    static char buf[SCAN_BUF_SIZE];
+    uint64_t pos = from, line = from_line;
+    uint64_t seen = from;   // 마지막으로 본 줄 시작
+
+    while (line < target) {
+        if (extend && pos - from >= limit && seen > from) {
+            ix->scanned_off = seen;
+            ix->scanned_line = line;
+            *off = seen;
+            return 1;
+        }
+
+        ssize_t n = pread(fd, buf, sizeof(buf), pos);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        char *p = buf, *end = buf + n;
+        while (line < target && (p = memchr(p, '\n', end - p)) != NULL) {
+            p++;
+            line++;
+
+            uint64_t start = pos + (p - buf);
+            seen = start;
+            if (extend && start - ix->marks[ix->nmarks - 1].off >= LINEIDX_STRIDE &&
+                add_mark(ix, start, line) < 0) {
+                return -1;
+            }
+        }
+
+        if (line == target) {
+            pos += p - buf;
+            break;
+        }
+        pos += n;
+    }
+
+    if (extend && pos >= ix->scanned_off) {
+        ix->scanned_off = pos;
+        ix->scanned_line = line;
+        if (line < target) {
+            // 마지막 줄이 개행 없이 끝나면 그것도 한 줄
+            ix->complete = 1;
+            char last;
+            if (pos > 0 && pread(fd, &last, 1, pos - 1) == 1 && last != '\n') {
+                ix->scanned_line++;
+            }
+        }
+    }
+
+    *off = pos;
+    return 0;
+}
+
+/* line 번째 줄 (0 부터) 이 시작하는 위치를 찾는다. 줄 수보다 크면 파일 크기.
+ * 이미 스캔한 구간은 기록해 둔 위치를 이분 탐색한 뒤 STRIDE 이내만 읽는다 */
+int lineidx_seek(line_index_t *ix, int fd, uint64_t line, uint64_t *off)
+{
+    if (line == 0) {
+        *off = 0;
+        return 0;
+    }
+
+    if (line >= ix->scanned_line) {
+        if (ix->complete) {
+            *off = ix->size;
+            return 0;
+        }
+        return scan_lines(ix, fd, ix->scanned_off, ix->scanned_line, line, 1, UINT64_MAX, off);
+    }
+
+    size_t lo = 0, hi = ix->nmarks;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (ix->marks[mid].line <= line) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return scan_lines(ix, fd, ix->marks[lo].off, ix->marks[lo].line, line, 0, UINT64_MAX, off);
+}
+
+/* line 번째 줄까지 인덱스를 LINEIDX_BUILD_CHUNK 씩 늘린다. 이벤트 루프를 오래 붙잡지 않도록
+ * 1 이 나올 때까지 나눠 부르고, 그 뒤의 lineidx_seek 은 STRIDE 이내만 읽는다 */
+int lineidx_build(line_index_t *ix, int fd, uint64_t line)
+{
+    uint64_t off;
+
+    if (ix->complete || line <= ix->scanned_line) {
+        return 1;
+    }
+
+    int r = scan_lines(ix, fd, ix->scanned_off, ix->scanned_line, line, 1, LINEIDX_BUILD_CHUNK, &off);
+    return r < 0 ? -1 : r == 0;
+}
+
+/* 전체 줄 수. 아직 끝까지 스캔하지 않았으면 UINT64_MAX */
+uint64_t lineidx_total(const line_index_t *ix)
+{
+    return ix->complete ? ix->scanned_line : UINT64_MAX;
+}
@@ -0,0 +1,41 @@
+#ifndef MYSH_LINEIDX_H
+#define MYSH_LINEIDX_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define LINEIDX_STRIDE      (64 * 1024)     // 이만큼마다 줄 시작 위치를 하나 기록
+#define LINEIDX_CACHE_SIZE  (16)            // 인덱스를 기억해 두는 파일 수
+#define LINEIDX_BUILD_CHUNK (4 * 1024 * 1024) // lineidx_build 한 번에 스캔하는 양
+
+/* 줄 번호 -> 파일 위치 (line 번째 줄이 off 에서 시작) */
+typedef struct line_mark {
+    uint64_t    off;
+    uint64_t    line;
+} line_mark_t;
+
+/* 파일 하나의 드문드문한 줄 위치 인덱스. 필요한 만큼만 앞에서부터 채운다 */
+typedef struct line_index {
+    dev_t       dev;                // 어떤 파일의 인덱스인지
+    ino_t       ino;
+    struct timespec mtime;          // 파일이 바뀌었는지 확인용
+    off_t       size;
+    line_mark_t *marks;             // off 순서 (= line 순서)
+    size_t      nmarks;
+    size_t      cap;
+    uint64_t    scanned_off;        // 여기까지 스캔함 (줄 시작 위치)
+    uint64_t    scanned_line;       // scanned_off 에서 시작하는 줄 번호
+    int         complete;           // 파일 끝까지 스캔했으면 1
+    int         refs;               // 쓰고 있는 요청 수. 0 이 아니면 다시 만들거나 밀어내지 않는다
+    int         priv;               // 캐시에 자리가 없어서 따로 만든 것 (다 쓰면 지운다)
+    uint64_t    last_used;
+} line_index_t;
+
+line_index_t *lineidx_get(const struct stat *st);   // 잡아 둔다. 실패하면 NULL
+void lineidx_put(line_index_t *ix);                 // NULL 이어도 된다
+int lineidx_build(line_index_t *ix, int fd, uint64_t line);   // 1: line 까지 됨, 0: 더 불러야 함, -1: 오류
+int lineidx_seek(line_index_t *ix, int fd, uint64_t line, uint64_t *off);
+uint64_t lineidx_total(const line_index_t *ix);
+
+#endif // MYSH_LINEIDX_H
@@ -5,15 +5,31 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <signal.h>
+#include <endian.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include "mysh.h"
+#include "frame.h"
+#include "dirscan.h"
+#include "lineidx.h"
+#include "snapshot.h"
+#include "watch.h"
+#include "dcache.h"
+#include "treecopy.h"
+#include "treerm.h"
+#include "job.h"
+#include "trash.h"
 
 #define MAX_CMDLINE_SIZE    (128)
 #define MAX_CMD_SIZE        (32)
-#define MAX_ARG             (4)
+#define MAX_ARG             (8)
+#define FILE_CHUNK_SIZE     (64 * 1024)
+#define FILE_SENDFILE_CHUNK (1024 * 1024)   // sendfile 로 보내는 FT_FILE 프레임 하나의 크기
+#define LISTING_CHUNK_SIZE  (16 * 1024)
+#define LISTING_BLOB_CHUNK  (1024 * 1024)   // 캐시된 목록 바이트를 복사 없이 보내는 프레임 하나의 크기
 
 typedef int  (*cmd_func_t)(int argc, char **argv);
 typedef void (*usage_func_t)(void);
@@ -33,8 +49,14 @@ DECLARE_CMDFUNC(mkdir);
 DECLARE_CMDFUNC(touch);
 DECLARE_CMDFUNC(rmdir);
 DECLARE_CMDFUNC(cd);
+DECLARE_CMDFUNC(go);
 DECLARE_CMDFUNC(mv);
 DECLARE_CMDFUNC(ls);
+static void send_listing(int what);
+static int  send_window(uint32_t offset, uint32_t count, const char *sort);
+static int  send_since(uint32_t version);
+static void snapshot_note(int dfd, const char *rel);
+static int  delta_flush(void);
 DECLARE_CMDFUNC(ln);
 DECLARE_CMDFUNC(rm);
 DECLARE_CMDFUNC(chmod);
@@ -44,6 +66,13 @@ DECLARE_CMDFUNC(ps);
 DECLARE_CMDFUNC(kill);
 DECLARE_CMDFUNC(quit);
 DECLARE_CMDFUNC(exec);
+DECLARE_CMDFUNC(watch);
+DECLARE_CMDFUNC(cache);
+DECLARE_CMDFUNC(format);
+DECLARE_CMDFUNC(jobs);
+DECLARE_CMDFUNC(cancel);
+DECLARE_CMDFUNC(trash);
+DECLARE_CMDFUNC(restore);
 
 /* Command List */
 static cmd_t cmd_list[] = {
@@ -52,8 +81,9 @@ static cmd_t cmd_list[] = {
     {"touch",   cmd_touch,   NULL,        "create file"},
     {"rmdir",   cmd_rmdir,   usage_rmdir, "remove directory"},
     {"cd",      cmd_cd,      usage_cd,    "change current directory"},
+    {"go",      cmd_go,      usage_go,    "change directory and show its contents"},
     {"mv",      cmd_mv,      usage_mv,    "rename directory & file"},
-    {"ls",      cmd_ls,      NULL,        "show directory contents"},
+    {"ls",      cmd_ls,      usage_ls,    "show directory contents"},
     {"ln",      cmd_ln,      usage_ln,    "create link"},
     {"rm",      cmd_rm,      usage_rm,    "remove file"},
     {"chmod",   cmd_chmod,   usage_chmod, "change file mode"},
@@ -61,14 +91,22 @@ static cmd_t cmd_list[] = {
     {"cp",      cmd_cp,      usage_cp,    "copy file"},
     {"ps",      cmd_ps,      NULL,        "show process status"},
     {"kill",    cmd_kill,    usage_kill,  "terminate process"},
-    {"quit",    cmd_quit,    NULL,        "terminate shell"},
+    {"quit",    cmd_quit,    NULL,        "terminate session"},
     {"exec",    cmd_exec,    NULL,        ""},
+    {"watch",   cmd_watch,   usage_watch, "notify when file changes"},
+    {"cache",   cmd_cache,   usage_cache, "show directory cache statistics"},
+    {"format",  cmd_format,  usage_format, "choose text or binary directory listings"},
+    {"jobs",    cmd_jobs,    usage_jobs,  "show background jobs (cp, rm -r, exec)"},
+    {"cancel",  cmd_cancel,  usage_cancel, "cancel background job"},
+    {"trash",   cmd_trash,   usage_trash, "show trash (rm -t), -e to empty it now"},
+    {"restore", cmd_restore, usage_restore, "restore item from trash"},
 };
 
 const int command_num = sizeof(cmd_list) / sizeof(cmd_t);
 char *chroot_path = "/tmp/test";
-char *current_dir;
-extern int client_fd;
+int root_fd = -1;
+static int ls_echo = 0;     // ls 결과를 서버 stdout 에도 출력 (디버그용)
+static int cache_flush_ok = 0;  // cache flush 허용. 캐시는 모든 세션이 같이 쓰므로 MYSH_DCACHE_FLUSH 가 있을 때만
 
 static int search_command(char *cmd)
 {
@@ -85,23 +123,30 @@ static int search_command(char *cmd)
     return (-1);
 }
 
-void get_realpath(char *usr_path, char *result)
+/* usr_path 를 chroot 기준의 정규화된 경로("/a/b")로 변환한다.
+ * 작업 디렉토리와 합친 경로나 결과가 PATH_MAX 를 넘으면 -1 (ENAMETOOLONG) */
+static int normalize_path(const char *usr_path, char *result, size_t size)
 {
-    char *stack[32];
+    char *stack[PATH_MAX / 2];  // "/x" 마다 하나
     int   index = 0;
-    char  fullpath[128];
-    char *tok;
-    int   i;
+    char  fullpath[PATH_MAX];
+    char *tok, *save;
+    int   i, n;
+    size_t len = 0;
 #define PATH_TOKEN   "/"
 
     if (usr_path[0] == '/') {
-        strncpy(fullpath, usr_path, sizeof(fullpath)-1);
+        n = snprintf(fullpath, sizeof(fullpath), "%s", usr_path);
     } else {
-        snprintf(fullpath, sizeof(fullpath)-1, "%s/%s", current_dir + strlen(chroot_path), usr_path);
+        n = snprintf(fullpath, sizeof(fullpath), "%s/%s", cur_session->cwd, usr_path);
+    }
+    if (n < 0 || (size_t)n >= sizeof(fullpath)) {
+        errno = ENAMETOOLONG;
+        return (-1);
     }
 
     /* parsing */
-    tok = strtok(fullpath, PATH_TOKEN);
+    tok = strtok_r(fullpath, PATH_TOKEN, &save);
     if (tok == NULL) {
         goto out;
     }
@@ -114,41 +159,103 @@ void get_realpath(char *usr_path, char *result)
         } else {
             stack[index++] = tok;
         }
-    } while ((tok = strtok(NULL, PATH_TOKEN)) && (index < 32));
+    } while ((tok = strtok_r(NULL, PATH_TOKEN, &save)) != NULL);
 
 out:
-    strcpy(result, chroot_path);
-
-    // TODO: boundary check
+    result[0] = '\0';
     for (i = 0; i < index; i++) {
-        strcat(result, "/");
-        strcat(result, stack[i]);
+        len += snprintf(result + len, len < size ? size - len : 0, "/%s", stack[i]);
+    }
+    if (index == 0) {
+        len = snprintf(result, size, "/"); // for root path
+    }
+    if (len >= size) {
+        errno = ENAMETOOLONG;
+        return (-1);
+    }
+    return (0);
+}
+
+/* usr_path 의 실제 경로 (chroot_path + 정규화된 경로). 심볼릭 링크 대상과 exec 에만 쓴다 */
+int get_realpath(const char *usr_path, char *result, size_t size)
+{
+    char vpath[PATH_MAX];
+    int  n;
+
+    if (normalize_path(usr_path, vpath, sizeof(vpath)) < 0) {
+        return (-1);
+    }
+    n = snprintf(result, size, "%s%s", chroot_path, strcmp(vpath, "/") != 0 ? vpath : "");
+    if (n < 0 || (size_t)n >= size) {
+        errno = ENAMETOOLONG;
+        return (-1);
+    }
+    return (0);
+}
+
+/* usr_path 를 (디렉토리 fd, 상대 경로) 쌍으로 변환한다.
+ * ".." 가 없는 상대 경로는 세션 작업 디렉토리 기준으로 그대로 쓰고,
+ * 그 외에는 정규화해서 chroot 디렉토리 기준으로 바꾼다. 경로가 너무 길면 -1 (ENAMETOOLONG) */
+int resolve_at(const char *usr_path, char *rel, size_t size)
+{
+    char vpath[PATH_MAX];
+    const char *p = usr_path;
+
+    if (usr_path[0] != '/') {
+        while (*p) {
+            if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0')) break;
+            p = strchr(p, '/');
+            if (p == NULL) {
+                if ((size_t)snprintf(rel, size, "%s", usr_path) >= size) {
+                    errno = ENAMETOOLONG;
+                    return (-1);
+                }
+                return cur_session->cwd_fd;
+            }
+            p++;
+        }
+    }
+
+    if (normalize_path(usr_path, vpath, sizeof(vpath)) < 0) {
+        return (-1);
     }
+    snprintf(rel, size, "%s", vpath[1] ? vpath + 1 : ".");
+    return root_fd;
+}
+
+/* errno 를 설명하는 오류 프레임을 보낸다 */
+void send_error(const char *what)
+{
+    char msg[PATH_MAX + 64];
+    int  len = snprintf(msg, sizeof(msg), "%s: %s", what, strerror(errno));
+
+    send_frame(FT_ERROR, msg, len < (int)sizeof(msg) ? (size_t)len : sizeof(msg) - 1);
 }
 
 void init() {
-    current_dir = (char*) malloc(MAX_CMDLINE_SIZE);
-    if (current_dir == NULL) {
-        perror("current_dir malloc");
+    if (mkdir(chroot_path, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir chroot");
         exit(1);
     }
 
-    if (chdir(chroot_path) < 0) {
-        mkdir(chroot_path, 0755);
-        chdir(chroot_path);
+    root_fd = open(chroot_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        perror("open chroot");
+        exit(1);
     }
+
+    ls_echo = getenv("MYSH_LS_ECHO") != NULL;
+    cache_flush_ok = getenv("MYSH_DCACHE_FLUSH") != NULL;
+    dirscan_init();
+    dcache_init();
+    trash_init(root_fd, chroot_path);   // 실패해도 rm -t 만 안 된다
 }
 
-char* execute(char* command) {
+int execute(char* command) {
     char *tok_str;
     char *cmd_argv[MAX_ARG];
     int  cmd_argc, i, ret;
 
-    if (getcwd(current_dir, MAX_CMDLINE_SIZE) == NULL) {
-        perror("getcwd");
-        return "err";
-    }
-
     // if (strlen(current_dir) == strlen(chroot_path)) {
     //     printf("/"); // for root path
     // }
@@ -158,7 +265,7 @@ char* execute(char* command) {
 
     /* get arguments */
     tok_str = strtok(command, " \n");
-    if (tok_str == NULL) return "err";
+    if (tok_str == NULL) return (-2);
 
     cmd_argv[0] = tok_str;
 
@@ -171,12 +278,14 @@ char* execute(char* command) {
     }
 
     /* search command in list and call command function */
+    ret = -1;
     i = search_command(cmd_argv[0]);
     if (i < 0) {
         printf("%s: command not found\n", cmd_argv[0]);
     } else {
         if (cmd_list[i].cmd_func) {
             ret = cmd_list[i].cmd_func(cmd_argc, cmd_argv);
+            delta_flush();
             if (ret == 0) {
                 printf("return success\n");
             } else if (ret == -2 && cmd_list[i].usage_func) {
@@ -189,6 +298,8 @@ char* execute(char* command) {
             printf("no command function\n");
         }
     }
+
+    return (ret);
 }
 
 int cmd_help(int argc, char **argv)
@@ -221,15 +332,19 @@ int cmd_help(int argc, char **argv)
 int cmd_mkdir(int argc, char **argv)
 {
     int  ret = 0;
-    char rpath[128];
+    char vpath[PATH_MAX];
+    char rel[PATH_MAX];
+    int  dfd;
 
     if (argc == 2) {
-        get_realpath(argv[1], rpath);
-        
-        if ((ret = mkdir(rpath, 0755)) < 0) {
+        if (normalize_path(argv[1], vpath, sizeof(vpath)) < 0 ||
+            (dfd = resolve_at(argv[1], rel, sizeof(rel))) < 0 ||
+            mkdirat(dfd, rel, 0755) < 0) {
             perror(argv[0]);
+            ret = -1;
         } else {
-            printf("directory created: %s\n", rpath + strlen(chroot_path));
+            printf("directory created: %s\n", vpath);
+            snapshot_note(dfd, rel);
         }
     } else {
         ret = -2; // syntax error
@@ -241,21 +356,26 @@ int cmd_mkdir(int argc, char **argv)
 int cmd_touch(int argc, char **argv)
 {
     int  ret = 0;
-    char rpath[128];
+    char vpath[PATH_MAX];
+    char rel[PATH_MAX];
+    int  dfd = -1;
 
     if (argc == 2) {
-        get_realpath(argv[1], rpath);
+        if (normalize_path(argv[1], vpath, sizeof(vpath)) == 0) {
+            dfd = resolve_at(argv[1], rel, sizeof(rel));
+        }
 
         // O_CREAT | O_EXCL ensures the file is created only if it does not exist.
         // 0644 sets the file permissions.
-        int fd = open(rpath, O_CREAT | O_EXCL | O_WRONLY, 0644);
+        int fd = dfd < 0 ? -1 : openat(dfd, rel, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
         
         if (fd < 0) {
             perror(argv[0]);
             ret = -1; // Error creating the file
         } else {
-            printf("file created: %s\n", rpath + strlen(chroot_path));
+            printf("file created: %s\n", vpath);
             close(fd); // Close the file descriptor
+            snapshot_note(dfd, rel);
         }
     } else {
         ret = -2; // syntax error
@@ -267,15 +387,19 @@ int cmd_touch(int argc, char **argv)
 int cmd_rmdir(int argc, char **argv)
 {
     int  ret = 0;
-    char rpath[128];
+    char vpath[PATH_MAX];
+    char rel[PATH_MAX];
+    int  dfd;
 
     if (argc == 2) {
-        get_realpath(argv[1], rpath);
-        
-        if ((ret = rmdir(rpath)) < 0) {
+        if (normalize_path(argv[1], vpath, sizeof(vpath)) < 0 ||
+            (dfd = resolve_at(argv[1], rel, sizeof(rel))) < 0 ||
+            unlinkat(dfd, rel, AT_REMOVEDIR) < 0) {
             perror(argv[0]);
+            ret = -1;
         } else {
-            printf("directory removed: %s\n", rpath + strlen(chroot_path));
+            printf("directory removed: %s\n", vpath);
+            snapshot_note(dfd, rel);
         }
     } else {
         ret = -2; // syntax error
@@ -287,30 +411,52 @@ int cmd_rmdir(int argc, char **argv)
 int cmd_cd(int argc, char **argv)
 {
     int  ret = 0;
-    char rpath[128];
-    char response[1024] = {0};
+    char vpath[PATH_MAX];
+    int  fd;
 
     if (argc == 2) {
-        get_realpath(argv[1], rpath);
-
-        if ((ret = chdir(rpath)) < 0) {
+        fd = -1;
+        if (normalize_path(argv[1], vpath, sizeof(vpath)) == 0) {
+            fd = openat(root_fd, vpath[1] ? vpath + 1 : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (fd < 0) {
+            send_error(argv[1]);
             perror(argv[0]);
+            ret = -1;
+        } else {
+            close(cur_session->cwd_fd);
+            cur_session->cwd_fd = fd;
+            snprintf(cur_session->cwd, sizeof(cur_session->cwd), "%s", vpath);
+            watch_dir(cur_session);
         }
     } else {
         ret = -2;
     }
 
-    if (getcwd(current_dir, MAX_CMDLINE_SIZE) == NULL) {
-        perror("getcwd");
-        return "err";
+    send_frame(FT_PATH, cur_session->cwd, strlen(cur_session->cwd));
+
+    return (ret);
+}
+
+/* cd 후 바뀐 경로와 디렉토리 목록을 한 응답으로 보낸다 */
+int cmd_go(int argc, char **argv)
+{
+    int ret;
+
+    if (argc < 2 || argc > 4) {
+        return (-2);
+    }
+
+    if ((ret = cmd_cd(2, argv)) != 0) {
+        return (ret);
     }
 
-    if (strlen(current_dir) == strlen(chroot_path)) {
-        response[0] = '/'; // for root path
+    // go <dir> <count> [sort] 이면 정렬된 첫 페이지만
+    if (argc >= 3) {
+        ret = send_window(0, strtoul(argv[2], NULL, 10), argc == 4 ? argv[3] : "name");
     } else {
-        sprintf(response, "%s", current_dir + strlen(chroot_path));
+        send_info();
     }
-    send(client_fd, response, strlen(response), 0);
 
     return (ret);
 }
@@ -318,18 +464,23 @@ int cmd_cd(int argc, char **argv)
 int cmd_mv(int argc, char **argv)
 {
     int  ret = 0;
-    char rpath1[128];
-    char rpath2[128];
+    char vpath1[PATH_MAX];
+    char vpath2[PATH_MAX];
+    char rel1[PATH_MAX], rel2[PATH_MAX];
+    int  dfd1, dfd2;
 
     if (argc == 3) {
-
-        get_realpath(argv[1], rpath1);
-        get_realpath(argv[2], rpath2);
-
-        if ((ret = rename(rpath1, rpath2)) < 0) {
+        if (normalize_path(argv[1], vpath1, sizeof(vpath1)) < 0 ||
+            normalize_path(argv[2], vpath2, sizeof(vpath2)) < 0 ||
+            (dfd1 = resolve_at(argv[1], rel1, sizeof(rel1))) < 0 ||
+            (dfd2 = resolve_at(argv[2], rel2, sizeof(rel2))) < 0 ||
+            renameat(dfd1, rel1, dfd2, rel2) < 0) {
             perror(argv[0]);
+            ret = -1;
         } else {
-            printf("file moved: %s -> %s\n", rpath1 + strlen(chroot_path), rpath2 + strlen(chroot_path));
+            printf("file moved: %s -> %s\n", vpath1, vpath2);
+            snapshot_note(dfd1, rel1);
+            snapshot_note(dfd2, rel2);
         }
     } else {
         ret = -2;
@@ -395,53 +546,32 @@ static void get_perm_str(mode_t mode, char *perm_str)
 int cmd_ls(int argc, char **argv)
 {
     int ret = 0;
-    DIR *dp;
-    struct dirent *dep;
-    struct stat statbuf;
 
-    if (argc != 1) {
-        ret = -2;
+    if (argc == 2 && strcmp(argv[1], "-n") == 0) {
+        // 이름과 타입만 (대부분 stat 없이 getdents 결과만으로 응답)
+        send_listing(DIRSCAN_NAMES);
         goto out;
     }
 
-    if ((dp = opendir(".")) == NULL) {
-        ret = -1;
+    if (argc == 3 && strcmp(argv[1], "since") == 0) {
+        // 클라이언트가 가진 버전 이후의 변경분만
+        ret = send_since(strtoul(argv[2], NULL, 10));
         goto out;
     }
 
-    while (dep = readdir(dp)) {
-        lstat(dep->d_name, &statbuf);
-        char perm_str[10];
-        char symlink_str[1024];
-        memset(symlink_str, 0, sizeof(symlink_str));
-        get_perm_str(statbuf.st_mode, perm_str);
-        
-        if (S_ISLNK(statbuf.st_mode)) {
-            ssize_t len = readlink(dep->d_name, symlink_str, sizeof(symlink_str)-1);
-            if (len != -1) {
-                symlink_str[len] = '\0';
-            }
-        }
+    if (argc >= 4 && strcmp(argv[1], "-w") == 0) {
+        // 정렬된 목록에서 offset 부터 count 개만
+        ret = send_window(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10),
+                          argc == 5 ? argv[4] : "name");
+        goto out;
+    }
+
+    if (argc != 1) {
+        ret = -2;
+        goto out;
+    }
 
-        printf("%10ld %c%s %4s %d %d %d %d %d %d %d %s%s%s\n", 
-            dep->d_ino,
-            get_type_char(dep->d_type),
-            perm_str,
-            get_type_str(dep->d_type), 
-            (int)statbuf.st_uid,
-            (int)statbuf.st_gid,
-            (int)statbuf.st_atim.tv_sec,
-            (int)statbuf.st_mtim.tv_sec,
-            (int)statbuf.st_ctim.tv_sec,
-            (unsigned int)statbuf.st_nlink,
-            (int)statbuf.st_size,
-            dep->d_name,
-            S_ISLNK(statbuf.st_mode) ? " -> " : "",
-            S_ISLNK(statbuf.st_mode) ? symlink_str + strlen(chroot_path) : ""
-        );
-    }
-
-    closedir(dp);
+    // 한 번 스캔한 결과를 소켓 (및 디버그용 stdout) 으로 내보낸다
     send_info();
 out:
     return (ret);
@@ -450,7 +580,10 @@ out:
 int cmd_ln(int argc, char **argv)
 {
     int ret = 0;
-    char real_src[128], real_dst[128];
+    char real_src[PATH_MAX];
+    char vpath_dst[PATH_MAX];
+    char rel_src[PATH_MAX], rel_dst[PATH_MAX];
+    int  dfd_src, dfd_dst;
 
     if (argc < 3 || argc > 4) {
         ret = -2;
@@ -469,19 +602,29 @@ int cmd_ln(int argc, char **argv)
         arg_idx++;
     }
 
-    get_realpath(argv[arg_idx], real_src);
-    get_realpath(argv[arg_idx+1], real_dst);
+    // 심볼릭 링크 대상은 실제 경로로 저장한다 (목록에서는 chroot 기준으로 보여줌)
+    if (get_realpath(argv[arg_idx], real_src, sizeof(real_src)) < 0 ||
+        normalize_path(argv[arg_idx+1], vpath_dst, sizeof(vpath_dst)) < 0 ||
+        (dfd_dst = resolve_at(argv[arg_idx+1], rel_dst, sizeof(rel_dst))) < 0) {
+        perror(argv[0]);
+        ret = -1;
+        goto out;
+    }
 
     if (sflag) {
-        if (symlink(real_src, real_dst) == 0) {
-            printf("symbolic link created: %s\n", real_dst + strlen(chroot_path));
+        if (symlinkat(real_src, dfd_dst, rel_dst) == 0) {
+            printf("symbolic link created: %s\n", vpath_dst);
+            snapshot_note(dfd_dst, rel_dst);
         } else {
             perror("symlink");
             ret = -1;
         }
     } else {
-        if (link(real_src, real_dst) == 0) {
-            printf("hard link created: %s\n", real_dst + strlen(chroot_path));
+        dfd_src = resolve_at(argv[arg_idx], rel_src, sizeof(rel_src));
+        if (dfd_src >= 0 && linkat(dfd_src, rel_src, dfd_dst, rel_dst, 0) == 0) {
+            printf("hard link created: %s\n", vpath_dst);
+            snapshot_note(dfd_src, rel_src);   // 링크 수가 바뀜
+            snapshot_note(dfd_dst, rel_dst);
         } else {
             perror("link");
             ret = -1;
@@ -492,18 +635,145 @@ out:
     return ret;
 }
 
+/* 백그라운드로 실행하는 rm -r */
+typedef struct rm_job {
+    int     dfd;                // resolve_at 결과를 복제 (세션이 cd 해도 그대로)
+    char    rel[PATH_MAX];
+    tree_remove_stats_t stats;
+} rm_job_t;
+
+static int rm_run(job_t *job)
+{
+    rm_job_t  *rm = job->arg;
+    copy_ctl_t ctl = { .progress = job_progress, .arg = job, .cancel = &job->cancel };
+
+    return tree_remove(rm->dfd, rm->rel, &rm->stats, &ctl);
+}
+
+static void rm_finish(job_t *job)
+{
+    rm_job_t *rm = job->arg;
+    tree_remove_stats_t *st = &rm->stats;
+
+    for (int i = 0; i < st->nmsg; i++) {
+        fprintf(stderr, "rm: %s\n", st->msg[i]);
+    }
+    if (st->errors > (uint64_t)st->nmsg) {
+        fprintf(stderr, "rm: ... %llu more errors\n", (unsigned long long)(st->errors - st->nmsg));
+    }
+
+    printf("job %u %s: %s (%llu files, %llu dirs removed)\n", job->id,
+           job->cancel ? "cancelled" : job->status == 0 ? "done" : "failed", job->desc,
+           (unsigned long long)st->files, (unsigned long long)st->dirs);
+
+    if (st->files > 0 || st->dirs > 0) {
+        snapshot_note(rm->dfd, rm->rel);
+        delta_flush();
+    }
+}
+
+static void rm_release(void *arg)
+{
+    rm_job_t *rm = arg;
+
+    if (rm->dfd >= 0) close(rm->dfd);
+    tree_remove_stats_free(&rm->stats);
+    free(rm);
+}
+
+/* 루트 (".") 나 현재/상위 디렉토리를 가리키는 경로인지 (rm -r, rm -t 는 거부한다) */
+static int protected_path(const char *rel)
+{
+    const char *base = strrchr(rel, '/') ? strrchr(rel, '/') + 1 : rel;
+
+    return base[0] == '\0' || strcmp(base, ".") == 0 || strcmp(base, "..") == 0;
+}
+
+/* rm -r: 트리 전체를 작업 스레드들이 아래부터 지우는 백그라운드 작업 (cp 와 같은 방식으로 응답) */
+static int rm_recursive(const char *path)
+{
+    char desc[JOB_DESC_SIZE];
+    rm_job_t *rm = calloc(1, sizeof(rm_job_t));
+    job_t *job;
+    int dfd;
+
+    if (rm == NULL) {
+        perror("rm");
+        return (-1);
+    }
+    if ((dfd = resolve_at(path, rm->rel, sizeof(rm->rel))) < 0) {
+        send_error("rm");
+        free(rm);
+        return (-1);
+    }
+
+    if (protected_path(rm->rel)) {
+        fprintf(stderr, "rm: refusing to remove '%s'\n", path);
+        free(rm);
+        return (-1);
+    }
+
+    rm->dfd = fcntl(dfd, F_DUPFD_CLOEXEC, 0);
+    snprintf(desc, sizeof(desc), "rm -r %s", path);
+    if (rm->dfd < 0 || (job = job_start(desc, rm_run, rm_finish, NULL, rm_release, rm)) == NULL) {
+        send_error("rm");
+        rm_release(rm);
+        return (-1);
+    }
+
+    printf("job %u started: %s\n", job->id, desc);
+    return job_send(job);
+}
+
+/* rm -t: 휴지통으로 옮기기만 한다 (rename 한 번이라 크기와 상관없이 바로 끝남).
+ * 응답은 복구에 쓸 FT_TRASH 한 줄 */
+static int rm_trash(const char *path)
+{
+    char rel[PATH_MAX];
+    char vpath[PATH_MAX];
+    char id[TRASH_ID_SIZE];
+    char line[PATH_MAX + 64];
+    int  dfd = resolve_at(path, rel, sizeof(rel));
+
+    if (dfd >= 0 && protected_path(rel)) {
+        fprintf(stderr, "rm: refusing to remove '%s'\n", path);
+        return (-1);
+    }
+
+    if (dfd < 0 || normalize_path(path, vpath, sizeof(vpath)) < 0 ||
+        trash_put(dfd, rel, vpath, id, sizeof(id)) < 0) {
+        send_error("rm");
+        perror("rm");
+        return (-1);
+    }
+    printf("moved to trash: %s (%s)\n", vpath, id);
+    snapshot_note(dfd, rel);
+    return send_frame(FT_TRASH, line, trash_format(id, vpath, line, sizeof(line)));
+}
+
 int cmd_rm(int argc, char **argv)
 {
     int ret = 0;
-    char rpath[128];
+    char vpath[PATH_MAX];
+    char rel[PATH_MAX];
+    int  dfd;
+
+    if (argc == 3 && strcmp(argv[1], "-r") == 0) {
+        return rm_recursive(argv[2]);
+    }
+    if (argc == 3 && strcmp(argv[1], "-t") == 0) {
+        return rm_trash(argv[2]);
+    }
 
     if (argc == 2) {
-        get_realpath(argv[1], rpath);
-        
-        if ((ret = unlink(rpath)) < 0) {
+        if (normalize_path(argv[1], vpath, sizeof(vpath)) < 0 ||
+            (dfd = resolve_at(argv[1], rel, sizeof(rel))) < 0 ||
+            unlinkat(dfd, rel, 0) < 0) {
             perror(argv[0]);
+            ret = -1;
         } else {
-            printf("file removed: %s\n", rpath + strlen(chroot_path));
+            printf("file removed: %s\n", vpath);
+            snapshot_note(dfd, rel);
         }
     } else {
         ret = -2; // syntax error
@@ -514,7 +784,8 @@ int cmd_rm(int argc, char **argv)
 int cmd_chmod(int argc, char **argv)
 {
     int ret = 0;
-    char rpath[128];
+    char rel[PATH_MAX];
+    int  dfd;
     mode_t new_mode;
     struct stat statbuf;
 
@@ -523,10 +794,10 @@ int cmd_chmod(int argc, char **argv)
         goto out;
     }
 
-    get_realpath(argv[2], rpath);
+    dfd = resolve_at(argv[2], rel, sizeof(rel));
 
     // 파일 정보 읽기
-    if (stat(rpath, &statbuf) == -1) {
+    if (dfd < 0 || fstatat(dfd, rel, &statbuf, 0) == -1) {
         perror(argv[0]);
         ret = -1;
         goto out;
@@ -535,12 +806,13 @@ int cmd_chmod(int argc, char **argv)
     // 8진수 형식의 권한 변경 처리
     if (argv[1][0] >= '0' && argv[1][0] <= '7') {
         new_mode = strtol(argv[1], NULL, 8);
-        if (chmod(rpath, new_mode) == -1) {
+        if (fchmodat(dfd, rel, new_mode, 0) == -1) {
             perror(argv[0]);
             ret = -1;
             goto out;
         }
         printf("mode changed: %s\n", argv[1]);
+        snapshot_note(dfd, rel);
         goto out;
     }
 
@@ -611,97 +883,306 @@ int cmd_chmod(int argc, char **argv)
         }
     }
 
-    if (chmod(rpath, new_mode) == -1) {
+    if (fchmodat(dfd, rel, new_mode, 0) == -1) {
         perror(argv[0]);
         ret = -1;
         goto out;
     }
-    printf("mode changed: %s\n", argv[1] + strlen(chroot_path));
+    printf("mode changed: %s\n", argv[1]);
+    snapshot_note(dfd, rel);
 
 out:
     return ret;
 }
 
+/* 보내고 있는 파일 */
+typedef struct cat_state {
+    int     fd;
+    int     regular;        // 일반 파일이면 sendfile, 아니면 read
+    off_t   off;
+    off_t   end;            // 보낼 구간의 끝
+    int     indexing;       // cat -l: 아직 줄 위치를 찾는 중 (파일 정보를 보내기 전)
+    uint64_t first_line;    // cat -l 의 줄 구간
+    uint64_t count;
+    line_index_t *ix;       // cat -l: 다 보낼 때까지 잡아 둔 줄 인덱스
+    struct stat st;         // 연 때의 파일 (인덱스를 만드는 동안 바뀌었는지 확인)
+    char    vpath[PATH_MAX];
+} cat_state_t;
+
+static void cat_free(void *arg)
+{
+    cat_state_t *st = arg;
+
+    lineidx_put(st->ix);
+    close(st->fd);
+    free(st);
+}
+
+static char *put_u64(char *p, uint64_t v)
+{
+    uint32_t be[2] = { htonl(v >> 32), htonl(v & 0xFFFFFFFF) };
+
+    memcpy(p, be, 8);
+    return p + 8;
+}
+
+/* 파일 정보: 파일 크기, 구간 시작 위치, 구간 첫 줄 번호, 전체 줄 수 (모르면 UINT64_MAX) + 경로 */
+static int cat_send_info(cat_state_t *st, uint64_t first_line, uint64_t total_lines)
+{
+    char info[32 + PATH_MAX];
+    char *p;
+
+    p = put_u64(info, st->regular ? (uint64_t)st->st.st_size : UINT64_MAX);
+    p = put_u64(p, st->off);
+    p = put_u64(p, first_line);
+    p = put_u64(p, total_lines);
+    memcpy(p, st->vpath, strlen(st->vpath));
+    if (send_frame(FT_FILE_INFO, info, 32 + strlen(st->vpath)) == -1) {
+        perror("Error sending file info");
+        return (-1);
+    }
+    return (0);
+}
+
+/* cat -l: 줄 인덱스를 LINEIDX_BUILD_CHUNK 씩 만들면서 다른 세션에 양보하고,
+ * 구간의 위치를 다 찾으면 파일 정보를 보낸 뒤 내용 전송으로 넘어간다 */
+static int cat_index(cat_state_t *st)
+{
+    line_index_t *ix = st->ix;
+    struct stat now;
+    uint64_t start, end;
+    int r;
+
+    // 나눠 만드는 사이에 파일이 바뀌었으면 이미 만든 줄 위치가 맞지 않는다
+    if (fstat(st->fd, &now) < 0) {
+        r = -1;
+    } else if (now.st_size != st->st.st_size || now.st_mtim.tv_sec != st->st.st_mtim.tv_sec ||
+               now.st_mtim.tv_nsec != st->st.st_mtim.tv_nsec) {
+        errno = ESTALE;
+        r = -1;
+    } else {
+        r = lineidx_build(ix, st->fd, st->first_line + st->count);
+    }
+    if (r < 0) {
+        send_error(st->vpath);
+        return (-1);
+    }
+    if (r == 0) {
+        return (PRODUCER_YIELD);
+    }
+
+    if (lineidx_seek(ix, st->fd, st->first_line, &start) < 0 ||
+        lineidx_seek(ix, st->fd, st->first_line + st->count, &end) < 0) {
+        send_error(st->vpath);
+        return (-1);
+    }
+    st->off = start;
+    st->end = end;
+    st->indexing = 0;
+    return (cat_send_info(st, st->first_line, lineidx_total(ix)) < 0 ? -1 : 1);
+}
+
+/* 파일 내용을 FT_FILE 프레임으로 나눠 보낸다. 프레임 하나를 다 보낸 뒤에 다시 불린다 */
+static int cat_produce(void *arg)
+{
+    cat_state_t *st = arg;
+
+    if (st->indexing) {
+        return (cat_index(st));
+    }
+
+    if (st->regular) {
+        if (st->off >= st->end) {
+            return (0);
+        }
+
+        size_t chunk = st->end - st->off < FILE_SENDFILE_CHUNK ? st->end - st->off : FILE_SENDFILE_CHUNK;
+        if (send_file_frame(FT_FILE, st->fd, st->off, chunk) < 0) {
+            return (-1);
+        }
+        st->off += chunk;
+        return (1);
+    }
+
+    // 파이프 등 크기를 알 수 없는 파일은 끝까지 읽어서 보낸다
+    char buf[FILE_CHUNK_SIZE];
+    ssize_t n = read(st->fd, buf, sizeof(buf));
+    if (n < 0) {
+        perror("read");
+        return (-1);
+    }
+    if (n == 0 || send_frame(FT_FILE, buf, n) < 0) {
+        return (n == 0 ? 0 : -1);
+    }
+    return (1);
+}
+
+/*
+ * cat <file>                           파일 전체
+ * cat -c <offset> <length> <file>      바이트 구간
+ * cat -l <first> <count> <file>        줄 구간 (0 부터). 줄 위치는 파일별 인덱스로 찾는다
+ *                                      (인덱스가 없으면 producer 에서 나눠 만든 뒤에 응답)
+ */
 int cmd_cat(int argc, char **argv)
 {
     int ret = 0;
-    char rpath[128];
-    FILE *fp;
-    char *fileContent = NULL;
-    size_t fileSize = 0;
+    char vpath[PATH_MAX];
+    char rel[PATH_MAX];
+    char *path;
+    int  dfd, fd;
+    int  mode = 0;
+    uint64_t arg_start = 0, arg_count = 0;
+    uint64_t start, end, total_lines = UINT64_MAX;
+    struct stat st;
+    cat_state_t *cat;
 
-    if (argc != 2) {
+    if (argc == 2) {
+        path = argv[1];
+    } else if (argc == 5 && (strcmp(argv[1], "-c") == 0 || strcmp(argv[1], "-l") == 0)) {
+        mode = argv[1][1];
+        arg_start = strtoull(argv[2], NULL, 10);
+        arg_count = strtoull(argv[3], NULL, 10);
+        path = argv[4];
+    } else {
         ret = -2; // syntax error
         goto out;
     }
 
-    get_realpath(argv[1], rpath);
-
-    // 파일 열기
-    fp = fopen(rpath, "r");
-    if (fp == NULL) {
+    fd = -1;
+    if (normalize_path(path, vpath, sizeof(vpath)) == 0 && (dfd = resolve_at(path, rel, sizeof(rel))) >= 0) {
+        fd = openat(dfd, rel, O_RDONLY | O_CLOEXEC);    // 파일 열기
+    }
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        send_error(path);
         perror(argv[0]);
+        if (fd >= 0) close(fd);
         ret = -1; // 파일 열기 실패
-        send(client_fd, "error", 5, 0);
         goto out;
     }
-
-    // 파일 크기 확인
-    fseek(fp, 0, SEEK_END);
-    fileSize = ftell(fp);
-    rewind(fp);
-
-    // 파일 내용을 메모리에 읽기
-    fileContent = (char *)malloc(fileSize + 1); // 파일 크기 + NULL
-    if (fileContent == NULL) {
-        perror("Memory allocation failed");
+    if (S_ISDIR(st.st_mode) || (mode && !S_ISREG(st.st_mode))) {
+        errno = S_ISDIR(st.st_mode) ? EISDIR : ESPIPE;
+        send_error(path);
+        close(fd);
         ret = -1;
-        fclose(fp);
-        send(client_fd, "error", 5, 0);
         goto out;
     }
-    fread(fileContent, 1, fileSize, fp);
-    fileContent[fileSize] = '\0'; // NULL-terminate
-    fclose(fp);
 
-    // FILE_CONTENT_START 헤더 생성
-    char header[256];
-    snprintf(header, sizeof(header), "FILE_CONTENT_START:%s\n", rpath + strlen(chroot_path));
+    // 보낼 구간 [start, end). 줄 구간은 인덱스를 만든 뒤 cat_index 에서 정한다
+    start = 0;
+    end = st.st_size;
+    if (mode == 'c') {
+        start = arg_start < end ? arg_start : end;
+        end = arg_count < end - start ? start + arg_count : end;
+    } else if (mode == 0 && S_ISREG(st.st_mode)) {
+        // 전체 줄 수는 이미 아는 경우에만 알려 준다
+        line_index_t *ix = lineidx_get(&st);
+        if (ix != NULL) {
+            total_lines = lineidx_total(ix);
+        }
+        lineidx_put(ix);
+    }
 
-    // 헤더와 파일 내용 결합
-    size_t totalSize = strlen(header) + fileSize;
-    char *response = (char *)malloc(totalSize + 1); // 총 크기 + NULL
-    if (response == NULL) {
-        perror("Memory allocation failed");
-        free(fileContent);
+    cat = malloc(sizeof(cat_state_t));
+    if (cat == NULL || (mode == 'l' && (cat->ix = lineidx_get(&st)) == NULL)) {
+        send_error(path);
+        free(cat);
+        close(fd);
         ret = -1;
-        send(client_fd, "error", 5, 0);
         goto out;
     }
-    snprintf(response, totalSize + 1, "%s%s", header, fileContent);
-
-    // 클라이언트로 전송
-    if (send(client_fd, response, totalSize, 0) == -1) {
-        perror("Error sending file content");
+    if (mode != 'l') {
+        cat->ix = NULL;
+    }
+    cat->fd = fd;
+    cat->regular = S_ISREG(st.st_mode);
+    cat->off = start;
+    cat->end = end;
+    cat->indexing = mode == 'l';
+    cat->first_line = arg_start;
+    cat->count = arg_count;
+    cat->st = st;
+    strcpy(cat->vpath, vpath);
+
+    if (!cat->indexing && cat_send_info(cat, mode == 0 && cat->regular ? 0 : UINT64_MAX, total_lines) < 0) {
+        cat_free(cat);
         ret = -1;
+        goto out;
     }
 
-    // 메모리 해제
-    free(fileContent);
-    free(response);
+    // 내용은 소켓이 받을 수 있는 만큼씩 sendfile 로 스트리밍
+    set_producer(cat_produce, cat, cat_free);
 
 out:
     return ret;
 }
 
+/* 백그라운드로 실행하는 cp. 경로의 디렉토리 fd 는 복제해 둔다 (세션이 cd 하거나 닫혀도 그대로) */
+typedef struct cp_job {
+    int     sdfd;
+    int     ddfd;
+    char    src[PATH_MAX];
+    char    dst[PATH_MAX];
+    tree_copy_stats_t stats;
+} cp_job_t;
+
+static int cp_run(job_t *job)
+{
+    cp_job_t  *cp = job->arg;
+    copy_ctl_t ctl = { .progress = job_progress, .arg = job, .cancel = &job->cancel };
+    uint64_t   files, bytes;
+
+    // 전체 크기를 먼저 세어야 진행률과 남은 시간을 알 수 있다
+    if (tree_measure(cp->sdfd, cp->src, &files, &bytes, &job->cancel) < 0) {
+        return -1;
+    }
+    job_set_total(job, files, bytes);
+
+    return tree_copy(cp->sdfd, cp->src, cp->ddfd, cp->dst, &cp->stats, &ctl);
+}
+
+/* 이벤트 루프에서: 오류를 알리고 복사한 결과를 목록 변경분으로 보낸다 */
+static void cp_finish(job_t *job)
+{
+    cp_job_t *cp = job->arg;
+    tree_copy_stats_t *st = &cp->stats;
+
+    for (int i = 0; i < st->nmsg; i++) {
+        fprintf(stderr, "cp: %s\n", st->msg[i]);
+    }
+    if (st->errors > (uint64_t)st->nmsg) {
+        fprintf(stderr, "cp: ... %llu more errors\n", (unsigned long long)(st->errors - st->nmsg));
+    }
+
+    printf("job %u %s: %s (%llu files, %llu dirs, %llu bytes)\n", job->id,
+           job->cancel ? "cancelled" : job->status == 0 ? "done" : "failed", job->desc,
+           (unsigned long long)st->files, (unsigned long long)st->dirs, (unsigned long long)st->bytes);
+
+    if (st->files > 0 || st->dirs > 0) {
+        snapshot_note(cp->ddfd, cp->dst);
+        delta_flush();
+    }
+}
+
+static void cp_release(void *arg)
+{
+    cp_job_t *cp = arg;
+
+    if (cp->sdfd >= 0) close(cp->sdfd);
+    if (cp->ddfd >= 0) close(cp->ddfd);
+    tree_copy_stats_free(&cp->stats);
+    free(cp);
+}
+
+/* 복사는 백그라운드 작업으로 돌리고 바로 FT_JOB 으로 작업 번호를 돌려준다.
+ * 진행 상황과 결과 (목록 변경분 포함) 는 request id 0 응답으로 온다 */
 int cmd_cp(int argc, char **argv)
 {
     int ret = 0;
-    char rpath1[128];
-    char rpath2[128];
-    FILE *src, *dst;
-    char buf[256];
-    size_t nread;
+    char desc[JOB_DESC_SIZE];
+    int  dfd1, dfd2;
+    struct stat statbuf;
+    cp_job_t *cp;
+    job_t *job;
 
     int recursive = 0;
 
@@ -717,77 +1198,50 @@ int cmd_cp(int argc, char **argv)
         goto out;
     }
 
-    get_realpath(argv[1], rpath1);
-    get_realpath(argv[2], rpath2);
-
-    struct stat statbuf;
-    if (stat(rpath1, &statbuf) < 0) {
-        perror(argv[0]);
+    if ((cp = calloc(1, sizeof(cp_job_t))) == NULL) {
+        perror("cp");
         ret = -1;
         goto out;
     }
+    dfd1 = resolve_at(argv[1], cp->src, sizeof(cp->src));
+    dfd2 = resolve_at(argv[2], cp->dst, sizeof(cp->dst));
 
-    if (S_ISDIR(statbuf.st_mode)) {
-        if (!recursive) {
-            fprintf(stderr, "%s: %s is a directory (use -r to copy recursively)\n", argv[0], argv[1]);
-            ret = -1;
-            goto out;
-        }
-
-        // Create target directory
-        mkdir(rpath2, statbuf.st_mode);
-
-        DIR *dir = opendir(rpath1);
-        if (dir == NULL) {
-            perror(argv[0]);
-            ret = -1;
-            goto out;
-        }
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-                continue;
-
-            char src_path[256];
-            char dst_path[256];
-            snprintf(src_path, sizeof(src_path), "%s/%s", rpath1, entry->d_name);
-            snprintf(dst_path, sizeof(dst_path), "%s/%s", rpath2, entry->d_name);
-
-            char *new_argv[] = {argv[0], "-r", src_path, dst_path};
-            if (cmd_cp(4, new_argv) != 0) {
-                ret = -1;
-                break;
-            }
-        }
-
-        closedir(dir);
-    } else {
-        // Copy single file
-        src = fopen(rpath1, "rb");
-        if (src == NULL) {
-            perror(argv[0]);
-            ret = -1;
-            goto out;
-        }
-
-        dst = fopen(rpath2, "wb");
-        if (dst == NULL) {
-            perror(argv[0]);
-            fclose(src);
-            ret = -1;
-            goto out;
-        }
+    if (dfd1 < 0 || dfd2 < 0 || fstatat(dfd1, cp->src, &statbuf, 0) < 0) {
+        send_error(argv[1]);
+        free(cp);
+        ret = -1;
+        goto out;
+    }
+    if (!recursive && S_ISDIR(statbuf.st_mode)) {
+        fprintf(stderr, "cp: %s is a directory (use -r to copy recursively)\n", argv[1]);
+        free(cp);
+        ret = -1;
+        goto out;
+    }
+    if (S_ISDIR(statbuf.st_mode) && tree_contains(dfd1, cp->src, dfd2, cp->dst)) {
+        fprintf(stderr, "cp: cannot copy %s into itself (%s)\n", argv[1], argv[2]);
+        errno = EINVAL;
+        send_error(argv[2]);
+        free(cp);
+        ret = -1;
+        goto out;
+    }
 
-        while ((nread = fread(buf, 1, sizeof(buf), src)) > 0) {
-            fwrite(buf, 1, nread, dst);
-        }
+    cp->sdfd = fcntl(dfd1, F_DUPFD_CLOEXEC, 0);
+    cp->ddfd = fcntl(dfd2, F_DUPFD_CLOEXEC, 0);
+    snprintf(desc, sizeof(desc), "cp%s %s %s", recursive ? " -r" : "", argv[1], argv[2]);
 
-        fclose(src);
-        fclose(dst);
-        printf("file copied: %s -> %s\n", argv[1], argv[2]);
+    if (cp->sdfd < 0 || cp->ddfd < 0 ||
+        (job = job_start(desc, cp_run, cp_finish, NULL, cp_release, cp)) == NULL) {
+        send_error("cp");
+        cp_release(cp);
+        ret = -1;
+        goto out;
     }
 
+    printf("job %u started: %s\n", job->id, desc);
+    job_send(job);
+
 out:
     return ret;
 }
@@ -804,12 +1258,6 @@ int cmd_ps(int argc, char **argv)
     size_t sendBufferLen = 0;
     FILE *fp;
 
-    // 시작 문자열 추가
-    const char *header = "PROCESS_LIST_START\n";
-    size_t headerLen = strlen(header);
-    memcpy(sendBuffer, header, headerLen);
-    sendBufferLen += headerLen;
-
     dir = opendir("/proc");
     if (!dir) {
         perror("opendir");
@@ -850,7 +1298,7 @@ int cmd_ps(int argc, char **argv)
     closedir(dir);
 
     // 클라이언트로 전송
-    if (send(client_fd, sendBuffer, sendBufferLen, 0) < 0) {
+    if (send_frame(FT_PROCS, sendBuffer, sendBufferLen) < 0) {
         perror("send");
         return -1;
     }
@@ -885,7 +1333,8 @@ int cmd_kill(int argc, char **argv)
 
 int cmd_quit(int argc, char **argv)
 {
-    exit(1);
+    // 서버 전체가 아닌 현재 세션만 종료
+    cur_session->closing = 1;
     return 0;
 }
 
@@ -909,11 +1358,21 @@ void usage_cd(void)
     printf("cd <directory>\n");
 }
 
+void usage_go(void)
+{
+    printf("go <directory> [<count> [name|size|mtime]]\n");
+}
+
 void usage_mv(void)
 {
     printf("mv <old_name> <new_name>\n");
 }
 
+void usage_ls(void)
+{
+    printf("ls [-n | -w <offset> <count> [name|size|mtime] | since <version>]\n");
+}
+
 void usage_ln(void)
 {
     printf("ln [-s] <link_name> <target_name>\n");
@@ -921,7 +1380,7 @@ void usage_ln(void)
 
 void usage_rm(void)
 {
-    printf("rm <file>\n");
+    printf("rm [-r | -t] <file>\n");
 }
 
 void usage_chmod(void)
@@ -931,12 +1390,12 @@ void usage_chmod(void)
 
 void usage_cat(void)
 {
-    printf("cat <file>\n");
+    printf("cat [-c <offset> <length> | -l <first_line> <count>] <file>\n");
 }
 
 void usage_cp(void)
 {
-    printf("cp <source_file> <destination_file>\n");
+    printf("cp [-r] <source> <destination>\n");
 }
 
 void usage_kill(void)
@@ -944,76 +1403,1274 @@ void usage_kill(void)
     printf("kill <pid>\n");
 }
 
-void send_info()
+void usage_watch(void)
 {
-    DIR *dp;
-    struct dirent *dep;
-    struct stat statbuf;
-    char buffer[4096]; // 개별 데이터를 저장할 임시 버퍼
-    char sendBuffer[65536]; // 누적 데이터를 저장할 버퍼 (큰 크기 설정 필요)
-    size_t sendBufferLen = 0; // 누적 데이터 길이
-
-    if ((dp = opendir(".")) == NULL) {
-        return;
-    }
-
-    // 초기화
-    memset(sendBuffer, 0, sizeof(sendBuffer));
+    printf("watch [<file>]\n");
+}
 
-    while ((dep = readdir(dp))) {
-        lstat(dep->d_name, &statbuf);
-        char perm_str[10];
-        char symlink_str[1024];
-        memset(symlink_str, 0, sizeof(symlink_str));
-        get_perm_str(statbuf.st_mode, perm_str);
-        
-        if (S_ISLNK(statbuf.st_mode)) {
-            ssize_t len = readlink(dep->d_name, symlink_str, sizeof(symlink_str) - 1);
-            if (len != -1) {
-                symlink_str[len] = '\0';
-            }
-        }
+void usage_cache(void)
+{
+    printf("cache [flush]   (flush needs MYSH_DCACHE_FLUSH in the server environment)\n");
+}
 
-        // 데이터를 포맷팅하여 임시 버퍼에 저장
-        int len = snprintf(buffer, sizeof(buffer), 
-            "%d %c%s %4s %d %d %d %d %d %d %d %s%s%s\n",
-            dep->d_ino,
-            get_type_char(dep->d_type),
-            perm_str,
-            get_type_str(dep->d_type), 
-            (int)statbuf.st_uid,
-            (int)statbuf.st_gid,
-            (int)statbuf.st_atim.tv_sec,
-            (int)statbuf.st_mtim.tv_sec,
-            (int)statbuf.st_ctim.tv_sec,
-            (unsigned int)statbuf.st_nlink,
-            (int)statbuf.st_size,
-            dep->d_name,
-            S_ISLNK(statbuf.st_mode) ? " -> " : "",
-            S_ISLNK(statbuf.st_mode) ? symlink_str + strlen(chroot_path) : ""
-        );
-
-        // 임시 버퍼 내용을 누적 버퍼로 복사
-        if (sendBufferLen + len < sizeof(sendBuffer)) {
-            memcpy(sendBuffer + sendBufferLen, buffer, len);
-            sendBufferLen += len;
-        } else {
-            // 누적 버퍼가 가득 찬 경우
-            fprintf(stderr, "Buffer overflow: too much data to send\n");
-            closedir(dp);
-            return;
-        }
-    }
+void usage_format(void)
+{
+    printf("format [text|binary]\n");
+}
 
-    closedir(dp);
+void usage_jobs(void)
+{
+    printf("jobs [<job_id>]\n");
+}
 
-    // 클라이언트 소켓으로 한 번에 전송
-    if (send(client_fd, sendBuffer, sendBufferLen, 0) < 0) {
-        perror("send");
-    }
+void usage_cancel(void)
+{
+    printf("cancel <job_id>\n");
+}
+
+void usage_trash(void)
+{
+    printf("trash [-e]\n");
+}
+
+void usage_restore(void)
+{
+    printf("restore <trash_id> [<path>]\n");
+}
+
+/* 목록을 내보낼 곳 */
+#define LS_SINK_SOCKET      (0x1)
+#define LS_SINK_STDOUT      (0x2)   // 디버그용, MYSH_LS_ECHO 환경 변수로 켠다
+
+typedef struct listing_state {
+    dir_scan_t  scan;
+    int         what;                       // DIRSCAN_STAT: 전체 목록, DIRSCAN_NAMES: 이름만
+    int         sinks;
+    int         records;                    // 전체 목록을 FT_RECORDS 로
+    dir_snapshot_t *snap;                   // 캐시에서 가져온 목록, 또는 스캔하면서 캐시에 넣을 목록
+    int         cached;                     // snap 이 캐시에서 가져온 것
+    const snap_blob_t *blob;                // 캐시된 스냅샷에 붙은 목록 바이트 (있으면 그대로 보냄)
+    uint32_t    pos;
+    uint64_t    ticket;
+    size_t      len;
+    char        chunk[LISTING_CHUNK_SIZE];  // 한 번에 보내는 목록 조각
+    dir_batch_t batch;                      // 스캔 한 번 분량의 항목 테이블
+} listing_state_t;
+
+/* chroot 안을 가리키는 링크 대상은 chroot 기준 경로로 보여준다 */
+static const char *link_display(const char *link)
+{
+    size_t len = strlen(chroot_path);
+
+    if (strncmp(link, chroot_path, len) == 0) {
+        return link + len;
+    }
+    return link;
+}
+
+static void listing_free(void *arg)
+{
+    listing_state_t *st = arg;
+
+    dirscan_close(&st->scan);
+    snapshot_free(st->snap);
+    free(st);
+}
+
+static void echo_entry(const dir_entry_t *e)
+{
+    char perm_str[10];
+
+    get_perm_str(e->mode, perm_str);
+    printf("%10lu %c%s %4s %d %d %d %d %d %d %d %s%s%s\n", 
+        (unsigned long)e->ino,
+        get_type_char(e->d_type),
+        perm_str,
+        get_type_str(e->d_type), 
+        (int)e->uid,
+        (int)e->gid,
+        (int)e->atime,
+        (int)e->mtime,
+        (int)e->ctime,
+        (unsigned int)e->nlink,
+        (int)e->size,
+        e->name,
+        e->link ? " -> " : "",
+        e->link ? link_display(e->link) : ""
+    );
+}
+
+static int format_entry(const dir_entry_t *e, char *buffer, size_t size)
+{
+    char perm_str[10];
+
+    get_perm_str(e->mode, perm_str);
+    int len = snprintf(buffer, size, 
+        "%lu %c%s %4s %d %d %d %d %d %d %d %s%s%s\n",
+        (unsigned long)e->ino,
+        get_type_char(e->d_type),
+        perm_str,
+        get_type_str(e->d_type), 
+        (int)e->uid,
+        (int)e->gid,
+        (int)e->atime,
+        (int)e->mtime,
+        (int)e->ctime,
+        (unsigned int)e->nlink,
+        (int)e->size,
+        e->name,
+        e->link ? " -> " : "",
+        e->link ? link_display(e->link) : ""
+    );
+
+    return len < (int)size ? len : (int)size - 1;
+}
+
+/* FT_RECORDS 레코드 하나 (frame.h). 이름과 링크 대상은 str 에 붙이고 그 길이를 돌려준다 */
+static size_t put_record(char *rec, char *str, uint32_t str_off, const dir_entry_t *e)
+{
+    const char *link = e->link ? link_display(e->link) : "";
+    size_t   name_len = strlen(e->name), link_len = strlen(link);
+    uint64_t u64[3] = { htole64(e->ino), htole64(e->size), htole64(e->mtime) };
+    uint16_t u16[2] = { htole16(name_len), htole16(link_len) };
+    uint32_t u32[4] = {
+        htole32((e->mode & S_IFMT) ? e->mode : e->mode | DTTOIF(e->d_type)),    // 이름만 스캔한 항목
+        htole32(e->uid), htole32(e->gid), htole32(e->nlink)
+    };
+
+    str_off = htole32(str_off);
+    memcpy(rec, u64, 24);
+    memcpy(rec + 24, &str_off, 4);
+    memcpy(rec + 28, u16, 4);
+    memcpy(rec + 32, u32, 16);
+    memcpy(str, e->name, name_len);
+    memcpy(str + name_len, link, link_len);
+    return name_len + link_len;
+}
+
+/* 항목들을 FT_RECORDS 프레임으로 (LISTING_CHUNK_SIZE 단위) */
+static int send_records(const dir_entry_t *ents, int n)
+{
+    char chunk[LISTING_CHUNK_SIZE];
+    int  i = 0;
+
+    while (i < n) {
+        // 이번 프레임에 들어갈 항목 수 (항목 하나는 항상 청크 안에 들어감)
+        size_t size = 8;
+        int k = i;
+        while (k < n) {
+            size_t one = FRAME_RECORD_SIZE + strlen(ents[k].name) + DIRSCAN_LINK_MAX;
+            if (size + one > sizeof(chunk)) break;
+            size += one;
+            k++;
+        }
+
+        char *str = chunk + 8 + (size_t)(k - i) * FRAME_RECORD_SIZE;
+        uint32_t hdr[2] = { htole32(k - i), 0 };
+        uint32_t str_len = 0;
+
+        memcpy(chunk, hdr, sizeof(hdr));
+        for (int j = i; j < k; j++) {
+            str_len += put_record(chunk + 8 + (size_t)(j - i) * FRAME_RECORD_SIZE, str + str_len, str_len, &ents[j]);
+        }
+        if (send_frame(FT_RECORDS, chunk, str + str_len - chunk) < 0) {
+            return (-1);
+        }
+        i = k;
+    }
+    return (0);
+}
+
+static void blob_release(void *snap)
+{
+    snapshot_free(snap);
+}
+
+/* 캐시된 스냅샷의 목록 바이트. 처음 부를 때 한 번만 포맷해서 스냅샷에 붙여 두고
+ * 스냅샷이 캐시에서 빠질 때 같이 버린다. order 가 있으면 그 순서 (ent 번호), 없으면 스냅샷 순서.
+ * 레코드 형식이면 buf 는 레코드 배열, 이름과 링크 대상은 strs (row_off 는 그 안의 위치) */
+static const snap_blob_t *listing_blob(dir_snapshot_t *snap, int kind, const uint32_t *order,
+                                       size_t stride, uint32_t rows)
+{
+    int records = kind >= SNAP_BLOB_RECORDS;
+    snap_blob_t *b;
+    size_t cap = 64 * 1024;
+    dir_entry_t e;
+
+    if (snap->blobs[kind]) {
+        return snap->blobs[kind];
+    }
+    if (!dcache_holds(snap) || (b = calloc(1, sizeof(snap_blob_t))) == NULL) {
+        return NULL;
+    }
+    if (order == NULL) {
+        rows = snap->live;
+    }
+    b->row_off = malloc(sizeof(size_t) * (rows + 1));
+    if (records) {
+        b->len = (size_t)rows * FRAME_RECORD_SIZE;
+        b->buf = malloc(b->len ? b->len : 1);
+        b->strs = malloc(cap);
+    } else {
+        b->buf = malloc(cap);
+    }
+    if (b->buf == NULL || b->row_off == NULL || (records && b->strs == NULL)) {
+        goto fail;
+    }
+
+    size_t len = 0;     // 텍스트 또는 문자열 테이블 길이
+    for (uint32_t i = 0, next = 0; b->rows < rows; i++) {
+        uint32_t idx;
+        if (order) {
+            idx = *(const uint32_t *)((const char *)order + stride * i);
+        } else {
+            while (snap->ent[next].removed) next++;
+            idx = next++;
+        }
+
+        if (len + NAME_MAX + DIRSCAN_LINK_MAX + 256 > cap) {
+            char *p = realloc(records ? b->strs : b->buf, cap * 2);
+            if (p == NULL) {
+                goto fail;
+            }
+            *(records ? &b->strs : &b->buf) = p;
+            cap *= 2;
+        }
+
+        snapshot_entry(snap, &snap->ent[idx], &e);
+        b->row_off[b->rows] = len;
+        if (records) {
+            len += put_record(b->buf + (size_t)b->rows * FRAME_RECORD_SIZE, b->strs + len, len, &e);
+        } else if (kind == SNAP_BLOB_NAMES) {
+            len += snprintf(b->buf + len, cap - len, "%s %s\n", get_type_str(e.d_type), e.name);
+        } else {
+            len += format_entry(&e, b->buf + len, cap - len);
+        }
+        b->rows++;
+    }
+    b->row_off[b->rows] = len;
+    if (!records) {
+        b->len = len;
+    }
+
+    snap->blobs[kind] = b;
+    dcache_resize(snap);
+    return b;
+
+fail:
+    free(b->buf);
+    free(b->row_off);
+    free(b->strs);
+    free(b);
+    return NULL;
+}
+
+/* 목록 바이트의 [*row, end) 행을 프레임 하나 (LISTING_BLOB_CHUNK 안쪽, 행 경계) 로 보낸다.
+ * 스냅샷 참조를 하나 잡아 두고 소켓으로 다 나가면 놓는다 */
+static int send_blob_rows(dir_snapshot_t *snap, const snap_blob_t *b, uint8_t type,
+                          uint32_t *row, uint32_t end)
+{
+    size_t rec = b->strs ? FRAME_RECORD_SIZE : 0;
+    uint32_t first = *row, k = first;
+    size_t start = b->row_off[first];
+
+    while (k < end && b->row_off[k + 1] - start + rec * (k + 1 - first) <= LISTING_BLOB_CHUNK) k++;
+    if (k == first) k++;    // 한 행이 청크보다 큰 경우
+    *row = k;
+
+    if (b->strs == NULL) {
+        return send_ref_frame(type, b->buf + start, b->row_off[k] - start, blob_release, snapshot_ref(snap));
+    }
+
+    // 레코드의 name_off 는 blob 전체의 문자열 테이블 기준이라 base 로 알려 준다
+    uint32_t hdr[2] = { htole32(k - first), htole32(start) };
+    struct iovec iov[2] = {
+        { b->buf + (size_t)first * FRAME_RECORD_SIZE, (size_t)(k - first) * FRAME_RECORD_SIZE },
+        { b->strs + start, b->row_off[k] - start },
+    };
+    return send_refv_frame(FT_RECORDS, hdr, sizeof(hdr), iov, 2, blob_release, snapshot_ref(snap));
+}
+
+/* 다음 항목 batch. 캐시에 있으면 스냅샷에서, 없으면 스캔하면서 스냅샷에도 모은다 */
+static int listing_next(listing_state_t *st)
+{
+    if (st->cached) {
+        int n = 0;
+        for (; st->pos < st->snap->count && n < DIRSCAN_BATCH; st->pos++) {
+            if (!st->snap->ent[st->pos].removed) {
+                snapshot_entry(st->snap, &st->snap->ent[st->pos], &st->batch.ent[n++]);
+            }
+        }
+        return n;
+    }
+
+    int n = dirscan_next(&st->scan, &st->batch);
+    if (st->snap == NULL || n < 0) {
+        return n;
+    }
+    if (n == 0) {
+        dcache_put(st->snap, st->ticket);
+        st->snap = NULL;
+        return 0;
+    }
+
+    dcache_stats_t cs;
+    dcache_get_stats(&cs);
+    for (int i = 0; i < n && st->snap; i++) {
+        // 캐시에 못 넣을 만큼 크면 모으기를 그만둬서 메모리를 일정하게 유지
+        if (snapshot_put(st->snap, &st->batch.ent[i]) < 0 || snapshot_bytes(st->snap) > cs.budget / 2) {
+            snapshot_free(st->snap);
+            st->snap = NULL;
+        }
+    }
+    return n;
+}
+
+/* 디렉토리를 한 번 스캔해서 얻은 항목 테이블을 켜져 있는 곳으로 내보낸다 */
+static int listing_produce(void *arg)
+{
+    listing_state_t *st = arg;
+    uint8_t type = st->what == DIRSCAN_STAT ? FT_LISTING : FT_NAMES;
+
+    if (st->blob) {
+        if (st->pos >= st->blob->rows) {
+            return (0);
+        }
+        return send_blob_rows(st->snap, st->blob, type, &st->pos, st->blob->rows) < 0 ? -1 : 1;
+    }
+
+    int n = listing_next(st);
+
+    if (n <= 0) {
+        return n;
+    }
+
+    if (st->records && (st->sinks & LS_SINK_SOCKET) && send_records(st->batch.ent, n) < 0) {
+        return (-1);
+    }
+
+    for (int i = 0; i < n; i++) {
+        const dir_entry_t *e = &st->batch.ent[i];
+
+        if ((st->sinks & LS_SINK_STDOUT) && st->what == DIRSCAN_STAT) {
+            echo_entry(e);
+        }
+        if (!(st->sinks & LS_SINK_SOCKET) || st->records) {
+            continue;
+        }
+
+        // 청크가 차면 일단 전송
+        if (st->len + NAME_MAX + DIRSCAN_LINK_MAX + 256 > sizeof(st->chunk)) {
+            if (send_frame(type, st->chunk, st->len) < 0) {
+                return (-1);
+            }
+            st->len = 0;
+        }
+        if (st->what == DIRSCAN_STAT) {
+            st->len += format_entry(e, st->chunk + st->len, sizeof(st->chunk) - st->len);
+        } else {
+            st->len += snprintf(st->chunk + st->len, sizeof(st->chunk) - st->len, "%s %s\n",
+                                get_type_str(e->d_type), e->name);
+        }
+    }
+
+    if (st->len > 0 && send_frame(type, st->chunk, st->len) < 0) {
+        perror("send");
+        return (-1);
+    }
+    st->len = 0;
+
+    return (1);
+}
+
+/* 현재 디렉토리 목록을 청크 단위로 스트리밍한다.
+ * 출력 버퍼가 차면 소켓이 비워질 때까지 스캔을 멈춘다. 캐시에 넣으려고 모으는 스냅샷도
+ * 캐시 예산의 절반까지만 들고 있으므로 디렉토리 크기와 무관하게 메모리가 일정하다 */
+static void send_listing(int what)
+{
+    listing_state_t *st = calloc(1, sizeof(listing_state_t));
+    struct stat dst;
+
+    if (st == NULL) {
+        perror("calloc");
+        return;
+    }
+
+    st->what = what;
+    st->sinks = LS_SINK_SOCKET | (ls_echo ? LS_SINK_STDOUT : 0);
+    st->records = what == DIRSCAN_STAT && cur_session->binary;
+    st->scan.fd = -1;
+
+    if ((st->snap = dcache_get(cur_session->cwd_fd)) != NULL) {
+        // 디버그 출력이 없으면 처음 한 번 포맷해 둔 바이트를 그대로 보낸다
+        if (!(st->sinks & LS_SINK_STDOUT)) {
+            int kind = what == DIRSCAN_STAT ? SNAP_BLOB_LIST : SNAP_BLOB_NAMES;
+            st->blob = listing_blob(st->snap, st->records ? SNAP_BLOB_RECORDS : kind, NULL, 0, 0);
+        }
+        st->cached = 1;
+        set_producer(listing_produce, st, listing_free);
+        return;
+    }
+
+    if (dirscan_open(&st->scan, cur_session->cwd_fd, ".", what) < 0) {
+        send_error(".");
+        free(st);
+        return;
+    }
+    if (what == DIRSCAN_STAT && fstat(st->scan.fd, &dst) == 0 &&
+        (st->ticket = dcache_begin(st->scan.fd, &dst)) != 0) {
+        st->snap = snapshot_new(dst.st_dev, dst.st_ino);
+    }
+
+    set_producer(listing_produce, st, listing_free);
+}
+
+void send_info()
+{
+    send_listing(DIRSCAN_STAT);
+}
+
+/* 정렬 기준 */
+#define LS_SORT_NAME        (0)
+#define LS_SORT_SIZE        (1)
+#define LS_SORT_MTIME       (2)
+
+/* 정렬용으로 모아 두는 항목 (이름은 names 풀 안) */
+typedef struct sort_rec {
+    uint64_t    ino;
+    int64_t     key;            // size 또는 mtime
+    uint32_t    name_off;
+    uint32_t    ent;            // 스냅샷이 있으면 그 안의 항목 번호
+    uint8_t     d_type;
+    uint8_t     rank;           // 0: ".", 1: "..", 2: 디렉토리, 3: 나머지
+} sort_rec_t;
+
+typedef struct window_state {
+    dir_scan_t  scan;
+    int         sort;
+    uint32_t    offset;         // 요청한 구간
+    uint32_t    count;
+    sort_rec_t *recs;           // 디렉토리 전체 항목
+    uint32_t    nrecs;
+    uint32_t    rec_cap;
+    char       *names;          // 스냅샷 없이 스캔할 때의 이름 풀
+    size_t      names_len;
+    size_t      names_cap;
+    int         scanning;       // 캐시에 없어서 디렉토리를 스캔하는 중
+    int         sorted;
+    dir_snapshot_t *snap;       // 전체 stat 결과 (캐시에서 가져왔거나 스캔하면서 만든 것)
+    uint64_t    ticket;         // 스캔한 결과를 캐시에 넣을 때 (dcache_begin)
+    const snap_blob_t *blob;    // 정렬된 목록 바이트 (캐시된 스냅샷에 붙음)
+    uint32_t    next;           // 다음에 보낼 순번
+    char        chunk[LISTING_CHUNK_SIZE];
+    dir_batch_t batch;
+} window_state_t;
+
+static const char *sort_names;  // qsort 비교 함수용 (reactor 스레드에서만 정렬)
+
+static void window_free(void *arg)
+{
+    window_state_t *st = arg;
+
+    dirscan_close(&st->scan);
+    snapshot_free(st->snap);
+    free(st->recs);
+    free(st->names);
+    free(st);
+}
+
+/* ".", ".." 가 맨 앞, 그 다음 디렉토리, 나머지는 key 순서 (같으면 이름순) */
+static uint8_t sort_rank(const char *name, uint8_t d_type)
+{
+    if (strcmp(name, ".") == 0) return 0;
+    if (strcmp(name, "..") == 0) return 1;
+    return d_type == DT_DIR ? 2 : 3;
+}
+
+static int window_grow(window_state_t *st, uint32_t n)
+{
+    if (st->nrecs + n > st->rec_cap) {
+        uint32_t cap = st->rec_cap ? st->rec_cap : 1024;
+        while (cap < st->nrecs + n) cap *= 2;
+
+        sort_rec_t *p = realloc(st->recs, sizeof(sort_rec_t) * cap);
+        if (p == NULL) return -1;
+        st->recs = p;
+        st->rec_cap = cap;
+    }
+    return 0;
+}
+
+/* 캐시에서 가져온 스냅샷으로 정렬용 테이블을 만든다 (스캔 없음) */
+static int window_from_snapshot(window_state_t *st)
+{
+    const dir_snapshot_t *snap = st->snap;
+
+    if (window_grow(st, snap->count) < 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < snap->count; i++) {
+        const snap_entry_t *se = &snap->ent[i];
+        if (se->removed) {
+            continue;
+        }
+
+        sort_rec_t *r = &st->recs[st->nrecs++];
+        r->ino = se->ino;
+        r->d_type = se->d_type;
+        r->rank = sort_rank(snap->strs + se->name_off, se->d_type);
+        r->key = st->sort == LS_SORT_SIZE ? se->size : st->sort == LS_SORT_MTIME ? se->mtime : 0;
+        r->name_off = se->name_off;
+        r->ent = i;
+    }
+    return 0;
+}
+
+static int compare_rec(const void *a, const void *b)
+{
+    const sort_rec_t *ra = a, *rb = b;
+
+    if (ra->rank != rb->rank) {
+        return ra->rank - rb->rank;
+    }
+    if (ra->key != rb->key) {
+        return ra->key < rb->key ? -1 : 1;
+    }
+    return strcmp(sort_names + ra->name_off, sort_names + rb->name_off);
+}
+
+/* 스캔한 batch 를 정렬용 테이블에 붙인다 */
+static int window_collect(window_state_t *st, int n)
+{
+    if (window_grow(st, n) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const dir_entry_t *e = &st->batch.ent[i];
+        size_t len = strlen(e->name) + 1;
+        sort_rec_t *r = &st->recs[st->nrecs++];
+
+        r->ino = e->ino;
+        r->d_type = e->d_type;
+        r->rank = sort_rank(e->name, e->d_type);
+        r->key = st->sort == LS_SORT_SIZE ? e->size : st->sort == LS_SORT_MTIME ? e->mtime : 0;
+
+        // 전체 stat 하는 스캔이면 이름과 속성은 스냅샷에 모은다
+        if (st->snap) {
+            if (snapshot_put(st->snap, e) < 0) {
+                return -1;
+            }
+            r->ent = st->snap->count - 1;
+            r->name_off = st->snap->ent[r->ent].name_off;
+            continue;
+        }
+
+        if (st->names_len + len > st->names_cap) {
+            size_t cap = st->names_cap ? st->names_cap * 2 : 64 * 1024;
+            char *p = realloc(st->names, cap);
+            if (p == NULL) return -1;
+            st->names = p;
+            st->names_cap = cap;
+        }
+
+        r->name_off = st->names_len;
+        memcpy(st->names + st->names_len, e->name, len);
+        st->names_len += len;
+    }
+    return 0;
+}
+
+/* 1. 디렉토리 전체를 배치 단위로 스캔 (캐시에 있으면 생략) 2. 정렬 3. 요청한 구간 전송 */
+static int window_produce(void *arg)
+{
+    window_state_t *st = arg;
+
+    if (st->scanning) {
+        int n = dirscan_next(&st->scan, &st->batch);
+        if (n < 0) {
+            return (-1);
+        }
+        if (n > 0) {
+            return window_collect(st, n) < 0 ? -1 : 1;
+        }
+
+        // 다른 세션/요청도 쓸 수 있게 캐시에 넣는다. 스냅샷이 없으면 구간을 보낼 때 stat 한다
+        st->scanning = 0;
+        if (st->snap) {
+            dirscan_close(&st->scan);
+            dcache_put(snapshot_ref(st->snap), st->ticket);
+        }
+    }
+
+    if (!st->sorted) {
+        // 같은 스냅샷을 같은 기준으로 정렬한 적이 있으면 정렬도 포맷도 다시 하지 않는다
+        int kind = (cur_session->binary ? SNAP_BLOB_REC_BY_NAME : SNAP_BLOB_BY_NAME) + st->sort;
+        if (st->snap && st->snap->blobs[kind]) {
+            st->blob = st->snap->blobs[kind];
+            st->nrecs = st->blob->rows;
+        } else {
+            sort_names = st->snap ? st->snap->strs : st->names;
+            qsort(st->recs, st->nrecs, sizeof(sort_rec_t), compare_rec);
+            sort_names = NULL;
+            if (st->snap) {
+                st->blob = listing_blob(st->snap, kind, &st->recs[0].ent, sizeof(sort_rec_t), st->nrecs);
+            }
+        }
+        st->sorted = 1;
+
+        // 구간 정보: offset, 실제로 보내는 개수, 전체 개수
+        uint32_t end = st->offset < st->nrecs ? st->offset : st->nrecs;
+        if (st->count > st->nrecs - end) {
+            st->count = st->nrecs - end;
+        }
+        st->offset = end;
+        st->next = end;
+
+        uint32_t hdr[3] = { htonl(st->offset), htonl(st->count), htonl(st->nrecs) };
+        if (send_frame(FT_WINDOW, hdr, sizeof(hdr)) < 0) {
+            return (-1);
+        }
+
+        // 처음부터 보는 목록이면 이후 변경분 (FT_DELTA) 은 이 목록을 기준으로 보낸다.
+        // 세션 스냅샷은 변경분을 반영하면서 고치므로 캐시와 나누지 않고 복사한다
+        if (st->snap && st->offset == 0) {
+            dir_snapshot_t *old = cur_session->snap;
+            dir_snapshot_t *snap = snapshot_clone(st->snap);
+            uint32_t ver[2] = { 0, 0 };
+
+            if (snap == NULL) {
+                return (-1);
+            }
+            snap->version = old ? old->version + 1 : 1;
+            ver[1] = htonl(snap->version);
+            snapshot_free(old);
+            cur_session->snap = snap;
+            if (send_frame(FT_VERSION, ver, sizeof(ver)) < 0) {
+                return (-1);
+            }
+        }
+    }
+
+    uint32_t end = st->offset + st->count;
+    if (st->next >= end) {
+        return (0);
+    }
+    if (st->blob) {
+        return send_blob_rows(st->snap, st->blob, FT_LISTING, &st->next, end) < 0 ? -1 : 1;
+    }
+
+    // 구간 안의 항목을 batch 하나 분량씩. 스냅샷이 있으면 그대로, 없으면 지금 stat
+    dir_batch_t *batch = &st->batch;
+    batch->count = 0;
+    while (st->next < end && batch->count < DIRSCAN_BATCH) {
+        const sort_rec_t *r = &st->recs[st->next++];
+        dir_entry_t *e = &batch->ent[batch->count++];
+
+        if (st->snap) {
+            snapshot_entry(st->snap, &st->snap->ent[r->ent], e);
+            continue;
+        }
+        memset(e, 0, offsetof(dir_entry_t, name));
+        e->ino = r->ino;
+        e->d_type = r->d_type;
+        snprintf(e->name, sizeof(e->name), "%s", st->names + r->name_off);
+    }
+    if (st->snap == NULL) {
+        dirscan_fill(&st->scan, batch);
+    }
+    if (cur_session->binary) {
+        return send_records(batch->ent, batch->count) < 0 ? -1 : (st->next < end);
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < batch->count; i++) {
+        if (len + NAME_MAX + DIRSCAN_LINK_MAX + 256 > sizeof(st->chunk)) {
+            if (send_frame(FT_LISTING, st->chunk, len) < 0) {
+                return (-1);
+            }
+            len = 0;
+        }
+        len += format_entry(&batch->ent[i], st->chunk + len, sizeof(st->chunk) - len);
+    }
+    if (len > 0 && send_frame(FT_LISTING, st->chunk, len) < 0) {
+        return (-1);
+    }
+
+    return (st->next < end);
+}
+
+/* 현재 디렉토리를 정렬해서 [offset, offset + count) 구간만 보낸다.
+ * FT_WINDOW (offset, count, total) 다음에 해당 구간의 FT_LISTING 이 온다 */
+static int send_window(uint32_t offset, uint32_t count, const char *sort)
+{
+    window_state_t *st;
+    int sort_key;
+
+    if (strcmp(sort, "name") == 0) {
+        sort_key = LS_SORT_NAME;
+    } else if (strcmp(sort, "size") == 0) {
+        sort_key = LS_SORT_SIZE;
+    } else if (strcmp(sort, "mtime") == 0) {
+        sort_key = LS_SORT_MTIME;
+    } else {
+        return (-2);
+    }
+
+    st = calloc(1, sizeof(window_state_t));
+    if (st == NULL) {
+        perror("calloc");
+        return (-1);
+    }
+
+    st->sort = sort_key;
+    st->offset = offset;
+    st->count = count;
+    st->scan.fd = -1;
+
+    // 다른 세션이 최근에 본 디렉토리면 캐시된 스냅샷으로 바로 정렬한다
+    if ((st->snap = dcache_get(cur_session->cwd_fd)) != NULL) {
+        int kind = (cur_session->binary ? SNAP_BLOB_REC_BY_NAME : SNAP_BLOB_BY_NAME) + sort_key;
+        if (st->snap->blobs[kind] == NULL && window_from_snapshot(st) < 0) {
+            window_free(st);
+            return (-1);
+        }
+        set_producer(window_produce, st, window_free);
+        return (0);
+    }
+
+    // 처음부터 보는 목록은 변경분 계산에 쓸 스냅샷도 만든다 (전체 stat, 캐시에도 넣음).
+    // 다음 페이지는 이름순이면 getdents 결과만으로 정렬하고, 보낼 구간만 stat 한다
+    int what = sort_key == LS_SORT_NAME && offset > 0 ? DIRSCAN_NAMES : DIRSCAN_STAT;
+    if (dirscan_open(&st->scan, cur_session->cwd_fd, ".", what) < 0) {
+        send_error(".");
+        free(st);
+        return (-1);
+    }
+    if (what == DIRSCAN_STAT) {
+        struct stat dst;
+        if (fstat(st->scan.fd, &dst) < 0 || (st->snap = snapshot_new(dst.st_dev, dst.st_ino)) == NULL) {
+            send_error(".");
+            window_free(st);
+            return (-1);
+        }
+        st->ticket = dcache_begin(st->scan.fd, &dst);
+    }
+
+    st->scanning = 1;
+    set_producer(window_produce, st, window_free);
+    return (0);
+}
+
+/* 이번 명령으로 바뀐 현재 디렉토리 항목. 명령이 끝나면 FT_DELTA 로 보낸다 */
+static char  *delta_buf;
+static size_t delta_len;
+static size_t delta_cap;
+
+static void delta_add(int op, const dir_entry_t *e)
+{
+    char line[NAME_MAX + DIRSCAN_LINK_MAX + 256];
+    int  len;
+
+    if (op <= 0) {
+        return;
+    }
+
+    line[0] = op;
+    line[1] = ' ';
+    if (op == '-') {
+        len = 2 + snprintf(line + 2, sizeof(line) - 2, "%s\n", e->name);
+    } else {
+        len = 2 + format_entry(e, line + 2, sizeof(line) - 2);
+    }
+
+    if (delta_len + len > delta_cap) {
+        size_t cap = delta_cap ? delta_cap * 2 : 4096;
+        while (cap < delta_len + len) cap *= 2;
+
+        char *p = realloc(delta_buf, cap);
+        if (p == NULL) {
+            perror("realloc");
+            return;
+        }
+        delta_buf = p;
+        delta_cap = cap;
+    }
+    memcpy(delta_buf + delta_len, line, len);
+    delta_len += len;
+}
+
+/* 스냅샷에 name 의 현재 상태를 반영하고 바뀐 내용을 변경분에 넣는다 */
+static void snapshot_apply(int dfd, const char *name)
+{
+    char link[DIRSCAN_LINK_MAX];
+    dir_entry_t e;
+    int op;
+
+    if (dirscan_stat(dfd, name, &e, link, sizeof(link)) == 0) {
+        op = snapshot_update(cur_session->snap, name, &e);
+    } else if (errno == ENOENT) {
+        snprintf(e.name, sizeof(e.name), "%s", name);
+        op = snapshot_update(cur_session->snap, name, NULL);
+    } else {
+        return;
+    }
+    delta_add(op, &e);
+}
+
+/* (dfd, rel) 가 바뀌었다. 클라이언트가 보고 있는 디렉토리 안이면 변경분에 넣는다 */
+static void snapshot_note(int dfd, const char *rel)
+{
+    dir_snapshot_t *snap = cur_session ? cur_session->snap : NULL; // 세션이 닫힌 뒤에 끝난 작업이면 NULL
+    char  parent[PATH_MAX];
+    const char *name = rel;
+    int   pfd = dfd;
+    struct stat st;
+
+    // 마지막 경로 요소의 부모 디렉토리
+    const char *slash = strrchr(rel, '/');
+    if (slash != NULL) {
+        snprintf(parent, sizeof(parent), "%.*s", (int)(slash - rel), rel);
+        name = slash + 1;
+        pfd = openat(dfd, parent[0] ? parent : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (pfd < 0) {
+            return;
+        }
+    }
+
+    if (fstat(pfd, &st) == 0) {
+        // 캐시된 목록은 inotify 가 없어도 바로 무효로
+        dcache_invalidate(st.st_dev, st.st_ino);
+
+        if (snap && name[0] != '\0' && strcmp(name, ".") != 0 && strcmp(name, "..") != 0 &&
+            st.st_dev == snap->dev && st.st_ino == snap->ino) {
+            snapshot_apply(pfd, name);
+            snapshot_apply(pfd, ".");   // 디렉토리 자신의 mtime 도 바뀜
+        }
+    }
+
+    if (pfd != dfd) {
+        close(pfd);
+    }
+}
+
+/* 명령이 현재 디렉토리를 바꿨으면 변경분과 새 버전을 응답에 붙인다. 보냈으면 1 */
+static int delta_flush(void)
+{
+    dir_snapshot_t *snap = cur_session ? cur_session->snap : NULL;
+
+    if (delta_len == 0 || snap == NULL) {
+        delta_len = 0;
+        return 0;
+    }
+
+    uint32_t ver[2] = { htonl(snap->version), htonl(snap->version + 1) };
+    snap->version++;
+
+    for (size_t off = 0; off < delta_len; off += LISTING_CHUNK_SIZE) {
+        size_t len = delta_len - off < LISTING_CHUNK_SIZE ? delta_len - off : LISTING_CHUNK_SIZE;
+        send_frame(FT_DELTA, delta_buf + off, len);
+    }
+    send_frame(FT_VERSION, ver, sizeof(ver));
+    delta_len = 0;
+    return 1;
+}
+
+/* 감시 중인 현재 디렉토리에서 바뀐 이름들 (NUL 로 구분) 을 스냅샷에 반영한다.
+ * 이 세션이 직접 바꾼 것은 이미 반영돼 있으므로 다른 곳에서 바뀐 것만 나간다 */
+int snapshot_push(const char *names, size_t len)
+{
+    dir_snapshot_t *snap = cur_session->snap;
+    struct stat st;
+
+    if (snap == NULL || fstat(cur_session->cwd_fd, &st) < 0 ||
+        st.st_dev != snap->dev || st.st_ino != snap->ino) {
+        return 0; // 클라이언트가 이 디렉토리 목록을 갖고 있지 않음
+    }
+
+    for (size_t off = 0; off < len; off += strlen(names + off) + 1) {
+        if (strcmp(names + off, "..") != 0) {
+            snapshot_apply(cur_session->cwd_fd, names + off);
+        }
+    }
+    snapshot_apply(cur_session->cwd_fd, ".");
+    return delta_flush();
+}
+
+/* ls since: 디렉토리를 다시 스캔해서 (캐시에 있으면 그대로) 세션 스냅샷과 비교한 변경분만 보낸다 */
+typedef struct since_state {
+    dir_scan_t  scan;
+    dir_snapshot_t *next;       // 새로 스캔한 상태
+    uint64_t    ticket;
+    int         phase;          // 0: 스캔, 1: 추가/변경 찾기, 2: 삭제 찾기
+    uint32_t    pos;
+    int         changed;
+    size_t      len;
+    char        chunk[LISTING_CHUNK_SIZE];
+    dir_batch_t batch;
+} since_state_t;
+
+static void since_free(void *arg)
+{
+    since_state_t *st = arg;
+
+    dirscan_close(&st->scan);
+    snapshot_free(st->next);
+    free(st);
+}
+
+static int since_emit(since_state_t *st, int op, const dir_entry_t *e)
+{
+    if (st->len + NAME_MAX + DIRSCAN_LINK_MAX + 256 > sizeof(st->chunk)) {
+        if (send_frame(FT_DELTA, st->chunk, st->len) < 0) {
+            return -1;
+        }
+        st->len = 0;
+    }
+
+    st->chunk[st->len++] = op;
+    st->chunk[st->len++] = ' ';
+    if (op == '-') {
+        st->len += snprintf(st->chunk + st->len, sizeof(st->chunk) - st->len, "%s\n", e->name);
+    } else {
+        st->len += format_entry(e, st->chunk + st->len, sizeof(st->chunk) - st->len);
+    }
+    st->changed = 1;
+    return 0;
+}
+
+static int since_produce(void *arg)
+{
+    since_state_t *st = arg;
+    dir_snapshot_t *old = cur_session->snap;
+    dir_entry_t e;
+
+    if (st->phase == 0) {
+        int n = dirscan_next(&st->scan, &st->batch);
+        if (n < 0) {
+            return (-1);
+        }
+        for (int i = 0; i < n; i++) {
+            if (snapshot_put(st->next, &st->batch.ent[i]) < 0) {
+                return (-1);
+            }
+        }
+        if (n == 0) {
+            // 세션 스냅샷은 고쳐 쓰므로 캐시에는 복사본을 넣는다
+            dir_snapshot_t *copy = snapshot_clone(st->next);
+            if (copy) {
+                dcache_put(copy, st->ticket);
+            }
+            for (uint32_t i = 0; i < old->count; i++) old->ent[i].mark = 0;
+            st->phase = 1;
+        }
+        return (1);
+    }
+
+    // 한 번에 batch 하나 분량씩 비교
+    uint32_t end = st->pos + DIRSCAN_BATCH;
+
+    if (st->phase == 1) {
+        for (; st->pos < st->next->count && st->pos < end; st->pos++) {
+            snap_entry_t *ne = &st->next->ent[st->pos];
+            snap_entry_t *oe = snapshot_find(old, st->next->strs + ne->name_off);
+            int op = 0;
+
+            if (ne->removed) {
+                continue;
+            }
+            if (oe == NULL || oe->removed) {
+                op = '+';
+            } else {
+                oe->mark = 1;
+                if (snapshot_differs(old, oe, st->next, ne)) op = '~';
+            }
+            if (op) {
+                snapshot_entry(st->next, ne, &e);
+                if (since_emit(st, op, &e) < 0) return (-1);
+            }
+        }
+        if (st->pos == st->next->count) {
+            st->phase = 2;
+            st->pos = 0;
+        }
+        return (1);
+    }
+
+    for (; st->pos < old->count && st->pos < end; st->pos++) {
+        snap_entry_t *oe = &old->ent[st->pos];
+        if (!oe->removed && !oe->mark) {
+            snprintf(e.name, sizeof(e.name), "%s", old->strs + oe->name_off);
+            if (since_emit(st, '-', &e) < 0) return (-1);
+        }
+    }
+    if (st->pos < old->count) {
+        return (1);
+    }
+
+    // 새 상태로 바꾸고 버전 알림
+    uint32_t ver[2] = { htonl(old->version), htonl(old->version + st->changed) };
+    st->next->version = old->version + st->changed;
+    if (st->len > 0 && send_frame(FT_DELTA, st->chunk, st->len) < 0) {
+        return (-1);
+    }
+    snapshot_free(old);
+    cur_session->snap = st->next;
+    st->next = NULL;
+    return send_frame(FT_VERSION, ver, sizeof(ver)) < 0 ? -1 : 0;
+}
+
+static int send_since(uint32_t version)
+{
+    dir_snapshot_t *snap = cur_session->snap;
+    since_state_t *st;
+    struct stat dst;
+
+    // 클라이언트가 가진 목록과 다른 디렉토리/버전이면 처음부터 다시 받아야 한다
+    if (snap == NULL || snap->version != version || fstat(cur_session->cwd_fd, &dst) < 0 ||
+        dst.st_dev != snap->dev || dst.st_ino != snap->ino) {
+        errno = ESTALE;
+        send_error("ls since");
+        return (-1);
+    }
+
+    st = calloc(1, sizeof(since_state_t));
+    if (st == NULL) {
+        perror("calloc");
+        return (-1);
+    }
+    st->scan.fd = -1;
+
+    // 캐시에 있으면 스캔 없이 바로 비교
+    dir_snapshot_t *hit = dcache_get(cur_session->cwd_fd);
+    if (hit != NULL) {
+        st->next = snapshot_clone(hit);
+        snapshot_free(hit);
+        if (st->next == NULL) {
+            since_free(st);
+            return (-1);
+        }
+        for (uint32_t i = 0; i < snap->count; i++) snap->ent[i].mark = 0;
+        st->phase = 1;
+        set_producer(since_produce, st, since_free);
+        return (0);
+    }
+
+    if (dirscan_open(&st->scan, cur_session->cwd_fd, ".", DIRSCAN_STAT) < 0 ||
+        (st->next = snapshot_new(snap->dev, snap->ino)) == NULL) {
+        send_error(".");
+        since_free(st);
+        return (-1);
+    }
+    st->ticket = dcache_begin(st->scan.fd, &dst);
+
+    set_producer(since_produce, st, since_free);
+    return (0);
+}
+
+/* 뷰어에 열린 파일이 바뀌면 FT_NOTIFY 로 알려 준다. 인자가 없으면 해제.
+ * 현재 디렉토리는 cd 할 때 자동으로 감시한다 */
+int cmd_watch(int argc, char **argv)
+{
+    char rel[PATH_MAX];
+    int  dfd;
+
+    if (argc > 2) {
+        return (-2);
+    }
+
+    if (argc == 1) {
+        return watch_file(cur_session, -1, NULL);
+    }
+
+    dfd = resolve_at(argv[1], rel, sizeof(rel));
+    if (dfd < 0 || watch_file(cur_session, dfd, rel) < 0) {
+        send_error(argv[1]);
+        return (-1);
+    }
+    return (0);
+}
+
+/* 여러 세션이 같이 쓰는 디렉토리 캐시 상태 */
+/*
+ * cache           디렉토리 캐시 통계를 FT_STATS 로 보낸다
+ * cache flush     캐시를 비운다. 다른 세션의 캐시도 같이 비우므로 서버가 MYSH_DCACHE_FLUSH 로
+ *                 허용했을 때만 (아니면 EPERM)
+ */
+int cmd_cache(int argc, char **argv)
+{
+    dcache_stats_t cs;
+    char buf[512];
+    int  len;
+
+    if (argc == 2 && strcmp(argv[1], "flush") == 0) {
+        if (!cache_flush_ok) {
+            errno = EPERM;
+            send_error("cache flush");
+            return (-1);
+        }
+        dcache_flush();
+    } else if (argc != 1) {
+        return (-2);
+    }
+
+    dcache_get_stats(&cs);
+    printf("dcache: %u dirs, %zu / %zu bytes, hits %llu, misses %llu, evictions %llu, invalidations %llu\n",
+           cs.entries, cs.bytes, cs.budget, (unsigned long long)cs.hits, (unsigned long long)cs.misses,
+           (unsigned long long)cs.evictions, (unsigned long long)cs.invalidations);
+
+    len = snprintf(buf, sizeof(buf), "dirs %u\nbytes %zu\nbudget %zu\nhits %llu\nmisses %llu\n"
+                   "evictions %llu\ninvalidations %llu\n", cs.entries, cs.bytes, cs.budget,
+                   (unsigned long long)cs.hits, (unsigned long long)cs.misses,
+                   (unsigned long long)cs.evictions, (unsigned long long)cs.invalidations);
+    if (send_frame(FT_STATS, buf, len) < 0) {
+        perror("send");
+        return (-1);
+    }
+    return (0);
+}
+
+/* 이 세션의 전체 목록 (ls, ls -w, go) 형식. 변경분 (FT_DELTA) 은 항상 텍스트 */
+int cmd_format(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "text") == 0) {
+        cur_session->binary = 0;
+    } else if (argc == 2 && strcmp(argv[1], "binary") == 0) {
+        cur_session->binary = 1;
+    } else if (argc != 1) {
+        return (-2);
+    }
+
+    printf("listing format: %s\n", cur_session->binary ? "binary" : "text");
+    return (0);
+}
+
+/* exec 한 프로세스가 끝나기를 기다리는 작업. arg 는 pid, 반환 값은 종료 코드 (시그널이면 128 + 번호) */
+static int exec_run(job_t *job)
+{
+    pid_t pid = (pid_t)(intptr_t)job->arg;
+    int   status;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void exec_finish(job_t *job)
+{
+    printf("Process %d exited with status: %d\n", (int)(intptr_t)job->arg, job->status);
+}
+
+static void exec_stop(job_t *job)
+{
+    kill((pid_t)(intptr_t)job->arg, SIGTERM);
+}
+
+/* 백그라운드 작업 상태를 FT_JOB 으로. 번호를 주면 그 작업만 (진행 상황을 직접 물어볼 때) */
+int cmd_jobs(int argc, char **argv)
+{
+    job_t *job;
+
+    if (argc == 1) {
+        return job_send_all();
+    }
+    if (argc != 2) {
+        return (-2);
+    }
+
+    job = job_find(strtoul(argv[1], NULL, 10));
+    if (job == NULL) {
+        fprintf(stderr, "jobs: %s: no such job\n", argv[1]);
+        return (-1);
+    }
+    return job_send(job);
+}
+
+/* 실행 중인 작업을 멈춘다. 결과는 작업이 실제로 끝날 때 id 0 응답으로 온다 */
+int cmd_cancel(int argc, char **argv)
+{
+    job_t *job;
+
+    if (argc != 2) {
+        return (-2);
+    }
+
+    job = job_find(strtoul(argv[1], NULL, 10));
+    if (job == NULL || job_cancel(job) < 0) {
+        fprintf(stderr, "cancel: %s: no running job\n", argv[1]);
+        return (-1);
+    }
+    printf("job %u cancelling: %s\n", job->id, job->desc);
+    return job_send(job);
+}
+
+/* 휴지통 목록 (FT_TRASH). -e 는 보관 기간을 기다리지 않고 비우는 스레드를 깨운다 */
+int cmd_trash(int argc, char **argv)
+{
+    char  *list;
+    size_t len;
+    int    ret;
+
+    if (argc == 2 && strcmp(argv[1], "-e") == 0) {
+        trash_empty();
+        printf("trash: emptying\n");
+        return (0);
+    }
+    if (argc != 1) {
+        return (-2);
+    }
+
+    if ((list = trash_list(&len)) == NULL) {
+        perror("trash");
+        return (-1);
+    }
+    ret = send_frame(FT_TRASH, list, len);
+    free(list);
+    return ret;
+}
+
+/* 휴지통의 항목을 원래 경로 (또는 주어진 경로) 로 되돌린다. 그 자리에 이미 뭔가 있으면 실패 */
+int cmd_restore(int argc, char **argv)
+{
+    char origin[PATH_MAX];
+    char rel[PATH_MAX];
+    const char *dest;
+    int  dfd;
+
+    if (argc != 2 && argc != 3) {
+        return (-2);
+    }
+    if (argc == 3) {
+        dest = argv[2];
+    } else if (trash_origin(argv[1], origin, sizeof(origin)) == 0) {
+        dest = origin;
+    } else {
+        send_error("restore");
+        perror("restore");
+        return (-1);
+    }
+
+    dfd = resolve_at(dest, rel, sizeof(rel));
+    if (dfd < 0 || trash_restore(argv[1], dfd, rel) < 0) {
+        send_error("restore");
+        perror("restore");
+        return (-1);
+    }
+    printf("restored: %s -> %s\n", argv[1], dest);
+    snapshot_note(dfd, rel);
+    return (0);
 }
 
 int cmd_exec(int argc, char **argv) {
+    char desc[JOB_DESC_SIZE];
+    job_t *job;
+
     if (argc < 2) {
         fprintf(stderr, "Usage: exec <command> [args...]\n");
         return -2; // Syntax error
@@ -1021,12 +2678,11 @@ int cmd_exec(int argc, char **argv) {
 
     pid_t pid;
     int status;
-    char rpath[256]; // 명령어의 절대 경로 저장
+    char rpath[PATH_MAX]; // 명령어의 절대 경로 저장
 
     // get_realpath로 명령어 경로 확인
-    get_realpath(argv[1], rpath);
-    if (access(rpath, X_OK) != 0) {
-        fprintf(stderr, "Error: %s is not executable or does not exist.\n", rpath);
+    if (get_realpath(argv[1], rpath, sizeof(rpath)) < 0 || access(rpath, X_OK) != 0) {
+        fprintf(stderr, "Error: %s is not executable or does not exist.\n", argv[1]);
         return -1;
     }
 
@@ -1038,7 +2694,8 @@ int cmd_exec(int argc, char **argv) {
     }
 
     if (pid == 0) {
-        // 자식 프로세스: 명령 실행
+        // 자식 프로세스: 세션 작업 디렉토리에서 명령 실행
+        fchdir(cur_session->cwd_fd);
         char *exec_args[argc];
         exec_args[0] = rpath; // 절대 경로로 설정
         for (int i = 2; i < argc; i++) {
@@ -1052,16 +2709,15 @@ int cmd_exec(int argc, char **argv) {
             exit(EXIT_FAILURE);
         }
     } else {
-        // 부모 프로세스: 자식 프로세스 종료 대기
+        // 부모 프로세스: 종료는 백그라운드 작업이 기다린다 (그동안 다른 요청을 처리)
         printf("Executing process: %s\n", rpath);
-        waitpid(pid, &status, 0);
-
-        // 실행 결과 확인
-        if (WIFEXITED(status)) {
-            printf("Process exited with status: %d\n", WEXITSTATUS(status));
-        } else if (WIFSIGNALED(status)) {
-            printf("Process terminated by signal: %d\n", WTERMSIG(status));
+        snprintf(desc, sizeof(desc), "exec %s (pid %d)", argv[1], pid);
+        job = job_start(desc, exec_run, exec_finish, exec_stop, NULL, (void *)(intptr_t)pid);
+        if (job == NULL) {
+            waitpid(pid, &status, 0);
+            return -1;
         }
+        job_send(job);
     }
     return 0;
 }
\ No newline at end of file
@@ -1,10 +1,72 @@
 #ifndef CUSTOM_SHELL_H
 #define CUSTOM_SHELL_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define SESSION_INBUF_SIZE  (4096)
+#define SESSION_REF_IOV     (2)     // 프레임 하나의 payload 로 복사 없이 보낼 수 있는 메모리 조각 수
+
+struct dir_snapshot;
+struct session_watch;
+
+/* 응답을 나눠서 만들어 내는 함수. 1: 계속, 0: 끝, -1: 오류,
+ * PRODUCER_YIELD: 아직 보낼 것이 없음 (다른 세션을 먼저 처리한 뒤 다시 부른다) */
+typedef int (*producer_func_t)(void *arg);
+#define PRODUCER_YIELD      (2)
+
+/* 클라이언트 접속 하나에 해당하는 세션 */
+typedef struct session {
+    int     fd;                         // 클라이언트 소켓
+    int     cwd_fd;                     // 세션별 작업 디렉토리
+    char    cwd[PATH_MAX];              // chroot 기준 작업 디렉토리 경로 ("/" 부터)
+    int     closing;                    // 출력 전송 후 연결 종료
+    uint32_t req_id;                    // 처리 중인 요청 id
+    char    inbuf[SESSION_INBUF_SIZE];  // 아직 처리되지 않은 수신 데이터
+    size_t  inlen;
+    char   *outbuf;                     // 아직 전송되지 않은 응답 데이터
+    size_t  outlen;
+    size_t  outoff;
+    size_t  outcap;
+    producer_func_t producer;           // 스트리밍 중인 응답 (없으면 NULL)
+    void   *producer_arg;
+    void  (*producer_free)(void *);
+    int32_t status;                     // producer 가 끝나면 보낼 반환 값
+    int     yielded;                    // producer 가 양보해서 다시 부를 차례를 기다리는 중
+    struct session *yield_next;
+    int     sf_fd;                      // 출력 버퍼 다음에 sendfile 로 보낼 파일 구간
+    off_t   sf_off;
+    size_t  sf_left;                    // 0 이면 없음
+    struct iovec ref_iov[SESSION_REF_IOV]; // 출력 버퍼 다음에 복사 없이 보낼 메모리 (캐시된 목록)
+    int     ref_cnt;
+    size_t  ref_left;                   // 0 이면 없음
+    void  (*ref_release)(void *);       // 다 보냈거나 세션이 닫히면 ref_owner 를 놓는다
+    void   *ref_owner;
+    struct dir_snapshot *snap;          // 클라이언트에 마지막으로 보낸 현재 디렉토리 상태
+    struct session_watch *watch;        // inotify 로 감시 중인 디렉토리/파일
+    int     binary;                     // 목록을 FT_RECORDS 로 보냄 ("format binary")
+} session_t;
+
 /* 함수 프로토타입 */
 void init(void);                         // 초기화 함수
-char* execute(char* command);            // 명령어 실행 함수
+int execute(char* command);              // 명령어 실행 함수
 void send_info();                        // 폴더 내용 정보 전송 함수
-void get_realpath(char *usr_path, char *result);
+int get_realpath(const char *usr_path, char *result, size_t size); // 실패하면 -1 (ENAMETOOLONG)
+int resolve_at(const char *usr_path, char *rel, size_t size); // 경로 -> (dirfd, 상대 경로)
+int send_frame(uint8_t type, const void *buf, size_t len); // 현재 요청의 응답 프레임 전송
+int send_file_frame(uint8_t type, int fd, off_t off, size_t len); // 파일 구간을 payload 로 전송 (sendfile)
+int send_ref_frame(uint8_t type, const void *buf, size_t len, void (*release)(void *), void *owner); // 복사 없이 전송
+int send_refv_frame(uint8_t type, const void *head, size_t head_len, const struct iovec *iov, int iovcnt,
+                    void (*release)(void *), void *owner); // head 는 복사, iov 는 복사 없이 전송
+void send_error(const char *what);       // errno 로 오류 프레임 전송
+void set_producer(producer_func_t func, void *arg, void (*release)(void *)); // 응답 스트리밍 등록
+int snapshot_push(const char *names, size_t len); // 현재 디렉토리에서 바뀐 이름들의 변경분 전송
+
+extern session_t *cur_session;           // 현재 명령을 실행 중인 세션
+extern char *chroot_path;
+extern int root_fd;                      // chroot 디렉토리 fd
 
-#endif // CUSTOM_SHELL_H
\ No newline at end of file
+#endif // CUSTOM_SHELL_H
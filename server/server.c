@@ -1,28 +1,507 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
 #include "mysh.h"
+#include "frame.h"
+#include "snapshot.h"
+#include "watch.h"
+#include "job.h"
 
 #define PORT 8080
 #define BUFFER_SIZE 1024
+#define MAX_EVENTS 256
+#define OUT_HIGH_WATER (64 * 1024)  // 출력 버퍼가 이만큼 쌓이면 producer 를 멈춘다
 
-extern char *current_dir;
-extern char *chroot_path;
-int client_fd;
+session_t *cur_session;
+
+static int epoll_fd;
+static session_t *yield_head, *yield_tail;  // producer 가 양보한 세션 (도착 순서)
+
+// 세션이 아닌 epoll 이벤트 소스 (data.ptr 로 구분, 리스닝 소켓은 NULL)
+static char inotify_source, timer_source, job_source, job_timer_source;
+
+static session_t *session_new(int fd)
+{
+    session_t *s = calloc(1, sizeof(session_t));
+
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->fd = fd;
+    s->cwd_fd = openat(root_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    strcpy(s->cwd, "/");
+    if (s->cwd_fd < 0) {
+        perror("open chroot");
+        free(s);
+        return NULL;
+    }
+
+    watch_dir(s);
+    return s;
+}
+
+static void yield_push(session_t *s)
+{
+    if (s->yielded) {
+        return;
+    }
+    s->yielded = 1;
+    s->yield_next = NULL;
+    if (yield_tail) {
+        yield_tail->yield_next = s;
+    } else {
+        yield_head = s;
+    }
+    yield_tail = s;
+}
+
+static session_t *yield_pop(void)
+{
+    session_t *s = yield_head;
+
+    if (s) {
+        yield_head = s->yield_next;
+        if (yield_head == NULL) {
+            yield_tail = NULL;
+        }
+        s->yielded = 0;
+    }
+    return s;
+}
+
+static void yield_remove(session_t *s)
+{
+    session_t **pp = &yield_head, *prev = NULL;
+
+    if (!s->yielded) {
+        return;
+    }
+    while (*pp != s) {
+        prev = *pp;
+        pp = &(*pp)->yield_next;
+    }
+    *pp = s->yield_next;
+    if (yield_tail == s) {
+        yield_tail = prev;
+    }
+    s->yielded = 0;
+}
+
+static void session_close(session_t *s)
+{
+    printf("Client disconnected (fd %d)\n", s->fd);
+    yield_remove(s);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    close(s->cwd_fd);
+    if (s->producer && s->producer_free) {
+        s->producer_free(s->producer_arg);
+    }
+    watch_forget(s);
+    job_forget(s);
+    if (s->ref_release) {
+        s->ref_release(s->ref_owner);
+    }
+    snapshot_free(s->snap);
+    free(s->outbuf);
+    free(s);
+}
+
+/* 출력 버퍼를 가능한 만큼 전송한다. 연결이 끊어졌으면 -1 */
+static int session_flush(session_t *s)
+{
+    // 출력 버퍼 (프레임 헤더) 와 그 뒤의 캐시된 payload 를 한 번의 sendmsg 로
+    while (s->outoff < s->outlen || s->ref_left > 0) {
+        struct iovec iov[1 + SESSION_REF_IOV];
+        struct msghdr msg = { .msg_iov = iov };
+
+        if (s->outoff < s->outlen) {
+            iov[msg.msg_iovlen].iov_base = s->outbuf + s->outoff;
+            iov[msg.msg_iovlen++].iov_len = s->outlen - s->outoff;
+        }
+        for (int i = 0; i < s->ref_cnt; i++) {
+            if (s->ref_iov[i].iov_len > 0) {
+                iov[msg.msg_iovlen++] = s->ref_iov[i];
+            }
+        }
+
+        ssize_t n = sendmsg(s->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            perror("send");
+            return -1;
+        }
+
+        size_t head = s->outlen - s->outoff < (size_t)n ? s->outlen - s->outoff : (size_t)n;
+        s->outoff += head;
+        n -= head;
+        s->ref_left -= n;
+        for (int i = 0; i < s->ref_cnt && n > 0; i++) {
+            size_t part = s->ref_iov[i].iov_len < (size_t)n ? s->ref_iov[i].iov_len : (size_t)n;
+            s->ref_iov[i].iov_base = (char *)s->ref_iov[i].iov_base + part;
+            s->ref_iov[i].iov_len -= part;
+            n -= part;
+        }
+    }
+
+    s->outoff = s->outlen = 0;
+    if (s->ref_release) {
+        s->ref_release(s->ref_owner);
+        s->ref_release = NULL;
+        s->ref_owner = NULL;
+    }
+
+    // 헤더 뒤의 파일 내용은 사용자 공간을 거치지 않고 바로 소켓으로
+    while (s->sf_left > 0) {
+        ssize_t n = sendfile(s->fd, s->sf_fd, &s->sf_off, s->sf_left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            perror("sendfile");
+            return -1;
+        }
+        if (n == 0) {
+            // 전송 중에 파일이 줄어들면 프레임 길이를 맞출 수 없으므로 연결을 끊는다
+            fprintf(stderr, "File shrank during sendfile (fd %d)\n", s->fd);
+            return -1;
+        }
+        s->sf_left -= n;
+    }
+
+    return 0;
+}
+
+/* 아직 보내지 못한 응답이 있는지 */
+static int session_pending(session_t *s)
+{
+    return s->outlen > s->outoff || s->sf_left > 0 || s->ref_left > 0;
+}
+
+/* 세션 출력 버퍼 뒤에 데이터를 붙인다 */
+static int session_queue(session_t *s, const void *buf, size_t len)
+{
+    // 이미 보낸 앞부분을 정리해서 버퍼를 재사용
+    if (s->outoff > 0 && s->outlen + len > s->outcap) {
+        memmove(s->outbuf, s->outbuf + s->outoff, s->outlen - s->outoff);
+        s->outlen -= s->outoff;
+        s->outoff = 0;
+    }
+
+    if (s->outlen + len > s->outcap) {
+        size_t cap = s->outcap ? s->outcap : BUFFER_SIZE;
+        while (cap < s->outlen + len) cap *= 2;
+
+        char *p = realloc(s->outbuf, cap);
+        if (p == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        s->outbuf = p;
+        s->outcap = cap;
+    }
+
+    memcpy(s->outbuf + s->outlen, buf, len);
+    s->outlen += len;
+    return 0;
+}
+
+static int session_send_frame(session_t *s, uint8_t type, const void *buf, size_t len)
+{
+    char hdr[FRAME_HDR_SIZE];
+
+    frame_encode_header(hdr, type, 0, s->req_id, len);
+    if (session_queue(s, hdr, sizeof(hdr)) < 0 || session_queue(s, buf, len) < 0) {
+        return -1;
+    }
+
+    return session_flush(s);
+}
+
+int send_frame(uint8_t type, const void *buf, size_t len)
+{
+    if (cur_session == NULL) {
+        return -1;
+    }
+
+    return session_send_frame(cur_session, type, buf, len);
+}
+
+/* 프레임 헤더는 출력 버퍼로, payload 는 fd 의 [off, off + len) 을 sendfile 로 보낸다.
+ * 구간을 다 보낼 때까지 producer 를 다시 부르지 않으므로 순서가 섞이지 않는다 */
+int send_file_frame(uint8_t type, int fd, off_t off, size_t len)
+{
+    session_t *s = cur_session;
+    char hdr[FRAME_HDR_SIZE];
+
+    if (s == NULL || s->sf_left > 0 || s->ref_left > 0) {
+        return -1;
+    }
+
+    frame_encode_header(hdr, type, 0, s->req_id, len);
+    if (session_queue(s, hdr, sizeof(hdr)) < 0) {
+        return -1;
+    }
+
+    s->sf_fd = fd;
+    s->sf_off = off;
+    s->sf_left = len;
+    return session_flush(s);
+}
+
+/* 프레임 헤더와 head 는 출력 버퍼로, 나머지 payload 는 iov 를 복사하지 않고 그대로 보낸다.
+ * 다 보내면 release(owner) 를 부른다. 그 전까지 producer 를 다시 부르지 않는다 */
+int send_refv_frame(uint8_t type, const void *head, size_t head_len, const struct iovec *iov, int iovcnt,
+                    void (*release)(void *), void *owner)
+{
+    session_t *s = cur_session;
+    char hdr[FRAME_HDR_SIZE];
+    size_t len = head_len;
+
+    if (s == NULL || s->sf_left > 0 || s->ref_left > 0 || iovcnt > SESSION_REF_IOV) {
+        release(owner);
+        return -1;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
+    frame_encode_header(hdr, type, 0, s->req_id, len);
+    if (session_queue(s, hdr, sizeof(hdr)) < 0 || (head_len > 0 && session_queue(s, head, head_len) < 0)) {
+        release(owner);
+        return -1;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        s->ref_iov[i] = iov[i];
+    }
+    s->ref_cnt = iovcnt;
+    s->ref_left = len - head_len;
+    s->ref_release = release;
+    s->ref_owner = owner;
+    return session_flush(s);
+}
+
+int send_ref_frame(uint8_t type, const void *buf, size_t len, void (*release)(void *), void *owner)
+{
+    struct iovec iov = { .iov_base = (void *)buf, .iov_len = len };
+
+    return send_refv_frame(type, NULL, 0, &iov, 1, release, owner);
+}
+
+void set_producer(producer_func_t func, void *arg, void (*release)(void *))
+{
+    cur_session->producer = func;
+    cur_session->producer_arg = arg;
+    cur_session->producer_free = release;
+}
+
+static void session_send_end(session_t *s, int32_t status)
+{
+    status = htonl(status);
+    session_send_frame(s, FT_END, &status, sizeof(status));
+}
+
+/* 출력 버퍼에 여유가 있는 동안 producer 를 돌린다. 연결이 끊어졌으면 -1 */
+static int session_pump(session_t *s)
+{
+    while (s->producer) {
+        if (s->outlen - s->outoff >= OUT_HIGH_WATER || s->sf_left > 0 || s->ref_left > 0) {
+            if (session_flush(s) < 0) {
+                return -1;
+            }
+            if (s->outlen - s->outoff >= OUT_HIGH_WATER || s->sf_left > 0 || s->ref_left > 0) {
+                return 0; // EPOLLOUT 에서 계속
+            }
+        }
+
+        cur_session = s;
+        int r = s->producer(s->producer_arg);
+        cur_session = NULL;
+
+        if (r == PRODUCER_YIELD) {
+            yield_push(s);  // 다른 세션을 한 바퀴 처리한 뒤에 계속
+            break;
+        }
+        if (r <= 0) {
+            if (s->producer_free) {
+                s->producer_free(s->producer_arg);
+            }
+            s->producer = NULL;
+            session_send_end(s, r < 0 ? -1 : s->status);
+        }
+    }
+
+    return session_flush(s);
+}
+
+/* 요청 프레임 하나를 실행하고 FT_END 로 응답을 마무리한다.
+ * 명령어가 producer 를 등록했으면 FT_END 는 producer 가 끝난 뒤에 보낸다 */
+static void dispatch(session_t *s, const frame_t *req)
+{
+    char    command[SESSION_INBUF_SIZE];
+    int32_t status;
+
+    memcpy(command, req->payload, req->length);
+    command[req->length] = '\0';
+
+    printf("Received(fd %d, id %u): %s\n", s->fd, req->id, command);
+
+    s->req_id = req->id;
+
+    // 종료 조건
+    if (strncmp(command, "exit", 4) == 0) {
+        s->closing = 1;
+        status = 0;
+    } else {
+        cur_session = s;
+        status = execute(command);
+        cur_session = NULL;
+    }
+
+    if (s->producer) {
+        s->status = status;
+    } else {
+        session_send_end(s, status);
+    }
+}
+
+/* 수신 버퍼에 완전히 도착한 요청 프레임을 처리한다.
+ * 응답을 스트리밍하는 중이면 순서를 지키기 위해 다음 요청은 미룬다. 잘못된 프레임이면 -1 */
+static int process_input(session_t *s)
+{
+    size_t  off = 0;
+    frame_t req;
+    int     n = 0;
+
+    while (!s->closing && !s->producer &&
+           (n = frame_decode(s->inbuf + off, s->inlen - off, sizeof(s->inbuf) - FRAME_HDR_SIZE, &req)) > 0) {
+        if (req.type == FT_REQUEST) {
+            dispatch(s, &req);
+        } else {
+            fprintf(stderr, "Unexpected frame type 0x%02x (fd %d)\n", req.type, s->fd);
+        }
+        off += n;
+    }
+
+    if (n < 0) {
+        fprintf(stderr, "Protocol error (fd %d)\n", s->fd);
+        return -1;
+    }
+
+    memmove(s->inbuf, s->inbuf + off, s->inlen - off);
+    s->inlen -= off;
+    return 0;
+}
+
+/* 소켓에서 한 번 읽는다. 읽었으면 1, 더 읽을 게 없으면 0, 연결이 끊어졌으면 -1 */
+static int session_read(session_t *s)
+{
+    while (1) {
+        ssize_t n = read(s->fd, s->inbuf + s->inlen, sizeof(s->inbuf) - s->inlen);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            perror("read");
+            return -1;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        s->inlen += n;
+        return 1;
+    }
+}
+
+/* 세션에 할 일이 없어질 때까지 (EAGAIN) 전송, 스트리밍, 요청 처리, 수신을 반복한다.
+ * 엣지 트리거이므로 멈출 때는 항상 EAGAIN 을 본 상태여야 한다. 연결을 닫아야 하면 -1 */
+static int session_service(session_t *s)
+{
+    while (1) {
+        if (session_pump(s) < 0) {
+            return -1;
+        }
+        if (s->producer) {
+            return 0; // 소켓이 다시 쓰기 가능해지면 계속
+        }
+        if (s->closing) {
+            return session_pending(s) ? 0 : -1;
+        }
+
+        if (process_input(s) < 0) {
+            return -1;
+        }
+        if (s->producer || s->closing) {
+            continue;
+        }
+
+        int r = session_read(s);
+        if (r <= 0) {
+            return r;
+        }
+    }
+}
+
+static void accept_clients(int server_fd)
+{
+    struct sockaddr_in address;
+    socklen_t addrlen = sizeof(address);
+    struct epoll_event ev;
+    int fd, opt = 1;
+
+    while ((fd = accept4(server_fd, (struct sockaddr *)&address, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        // 응답은 출력 버퍼에 모아서 보내므로 작은 마지막 프레임 (FT_END) 이 Nagle 에 묶이지 않게
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        session_t *s = session_new(fd);
+        if (s == NULL) {
+            close(fd);
+            continue;
+        }
+
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = s;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            session_close(s);
+            continue;
+        }
+
+        printf("Client connected: %s:%d (fd %d)\n", inet_ntoa(address.sin_addr), ntohs(address.sin_port), fd);
+        addrlen = sizeof(address);
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("Accept failed");
+    }
+}
 
 int main() {
     int server_fd;
+    int opt = 1;
     struct sockaddr_in address;
-    int addrlen = sizeof(address);
-    char buffer[BUFFER_SIZE] = {0};
+    struct epoll_event ev, events[MAX_EVENTS];
+
+    signal(SIGPIPE, SIG_IGN);
 
     // 소켓 생성
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+    if ((server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
         perror("Socket failed");
         exit(EXIT_FAILURE);
     }
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
     // 주소 설정
     address.sin_family = AF_INET;
@@ -36,47 +515,101 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-listen:
-
     // 연결 대기
-    if (listen(server_fd, 3) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         perror("Listen failed");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
 
-    printf("Server is running on port %d...\n", PORT);
-
-    // 클라이언트 연결 허용
-    if ((client_fd = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0) {
-        perror("Accept failed");
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        perror("epoll_create1");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
 
+    // 리스닝 소켓은 data.ptr == NULL 로 구분
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+
     init();
 
+    // 감시 중인 디렉토리/파일 변경 알림. 없어도 서버는 동작한다
+    if (watch_init() == 0) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &inotify_source;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch_inotify_fd(), &ev);
+        ev.data.ptr = &timer_source;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch_timer_fd(), &ev);
+    }
+
+    // 백그라운드 작업 (cp, rm -r, exec) 이 끝났거나 진행 상황을 보낼 때
+    if (job_init() == 0) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &job_source;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, job_event_fd(), &ev);
+        ev.data.ptr = &job_timer_source;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, job_timer_fd(), &ev);
+    }
+
+    printf("Server is running on port %d...\n", PORT);
+
     while (1) {
-        // 클라이언트로부터 메시지 수신
-        ssize_t bytesRead = read(client_fd, buffer, BUFFER_SIZE);
-        if (bytesRead <= 0) {
-            printf("Client disconnected\n");
-            goto listen;
+        // 양보한 producer 가 있으면 기다리지 않고 이벤트만 확인한다
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, yield_head ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
         }
 
-        buffer[bytesRead] = '\0'; // Null-terminate the string
-        printf("Received: %s\n", buffer);
+        for (int i = 0; i < n; i++) {
+            session_t *s = events[i].data.ptr;
 
-        execute(buffer);
-    
-        // 종료 조건
-        if (strncmp(buffer, "exit", 4) == 0) {
-            printf("Exiting...\n");
-            break;
-        } 
+            if (s == NULL) {
+                accept_clients(server_fd);
+                continue;
+            }
+            if (events[i].data.ptr == &inotify_source) {
+                watch_handle_inotify();
+                continue;
+            }
+            if (events[i].data.ptr == &timer_source) {
+                watch_handle_timer();
+                continue;
+            }
+            if (events[i].data.ptr == &job_source) {
+                job_handle_event();
+                continue;
+            }
+            if (events[i].data.ptr == &job_timer_source) {
+                job_handle_timer();
+                continue;
+            }
+
+            if (session_service(s) < 0) {
+                session_close(s);
+            }
+        }
+
+        // 양보한 세션마다 한 번씩 (그 사이 다시 양보한 세션은 다음 바퀴에)
+        session_t *last = yield_tail;
+        while (last) {
+            session_t *s = yield_pop();
+            if (session_service(s) < 0) {
+                session_close(s);
+            }
+            if (s == last) {
+                break;
+            }
+        }
     }
 
-    close(client_fd);
+    close(epoll_fd);
     close(server_fd);
 
     return 0;
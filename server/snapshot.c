@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+dir_snapshot_t *snapshot_new(dev_t dev, ino_t ino)
+{
+    dir_snapshot_t *snap = calloc(1, sizeof(dir_snapshot_t));
+
+    if (snap == NULL) {
+        return NULL;
+    }
+    snap->dev = dev;
+    snap->ino = ino;
+    snap->refs = 1;
+    return snap;
+}
+
+void snapshot_free(dir_snapshot_t *snap)
+{
+    if (snap == NULL || --snap->refs > 0) {
+        return;
+    }
+    for (int i = 0; i < SNAP_BLOB_KINDS; i++) {
+        if (snap->blobs[i]) {
+            free(snap->blobs[i]->buf);
+            free(snap->blobs[i]->row_off);
+            free(snap->blobs[i]->strs);
+            free(snap->blobs[i]);
+        }
+    }
+    free(snap->ent);
+    free(snap->strs);
+    free(snap->hash);
+    free(snap);
+}
+
+dir_snapshot_t *snapshot_ref(dir_snapshot_t *snap)
+{
+    snap->refs++;
+    return snap;
+}
+
+/* 따로 고칠 수 있는 복사본 (버전은 0, 목록 바이트는 복사하지 않음) */
+dir_snapshot_t *snapshot_clone(const dir_snapshot_t *snap)
+{
+    dir_snapshot_t *copy = snapshot_new(snap->dev, snap->ino);
+
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->live = snap->live;
+    copy->count = copy->cap = snap->count;
+    copy->strs_len = copy->strs_cap = snap->strs_len;
+    copy->hash_size = snap->hash_size;
+    copy->ent = malloc(sizeof(snap_entry_t) * (snap->count ? snap->count : 1));
+    copy->strs = malloc(snap->strs_len ? snap->strs_len : 1);
+    copy->hash = malloc(sizeof(uint32_t) * (snap->hash_size ? snap->hash_size : 1));
+    if (copy->ent == NULL || copy->strs == NULL || copy->hash == NULL) {
+        snapshot_free(copy);
+        return NULL;
+    }
+
+    memcpy(copy->ent, snap->ent, sizeof(snap_entry_t) * snap->count);
+    memcpy(copy->strs, snap->strs, snap->strs_len);
+    memcpy(copy->hash, snap->hash, sizeof(uint32_t) * snap->hash_size);
+    return copy;
+}
+
+/* 들고 있는 메모리 (캐시 예산 계산용) */
+size_t snapshot_bytes(const dir_snapshot_t *snap)
+{
+    size_t bytes = sizeof(*snap) + sizeof(snap_entry_t) * snap->cap + snap->strs_cap +
+                   sizeof(uint32_t) * snap->hash_size;
+
+    for (int i = 0; i < SNAP_BLOB_KINDS; i++) {
+        const snap_blob_t *b = snap->blobs[i];
+        if (b) {
+            bytes += sizeof(snap_blob_t) + b->len + sizeof(size_t) * (b->rows + 1);
+            if (b->strs) {
+                bytes += b->row_off[b->rows];   // 레코드 형식의 문자열 테이블
+            }
+        }
+    }
+    return bytes;
+}
+
+/* FNV-1a */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static int hash_grow(dir_snapshot_t *snap)
+{
+    uint32_t size = snap->hash_size ? snap->hash_size * 2 : 1024;
+    uint32_t *hash = calloc(size, sizeof(uint32_t));
+
+    if (hash == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < snap->count; i++) {
+        uint32_t h = name_hash(snap->strs + snap->ent[i].name_off) & (size - 1);
+        while (hash[h]) h = (h + 1) & (size - 1);
+        hash[h] = i + 1;
+    }
+
+    free(snap->hash);
+    snap->hash = hash;
+    snap->hash_size = size;
+    return 0;
+}
+
+snap_entry_t *snapshot_find(dir_snapshot_t *snap, const char *name)
+{
+    if (snap->hash_size == 0) {
+        return NULL;
+    }
+
+    uint32_t mask = snap->hash_size - 1;
+    for (uint32_t h = name_hash(name) & mask; snap->hash[h]; h = (h + 1) & mask) {
+        snap_entry_t *se = &snap->ent[snap->hash[h] - 1];
+        if (strcmp(snap->strs + se->name_off, name) == 0) {
+            return se;
+        }
+    }
+    return NULL;
+}
+
+static int add_str(dir_snapshot_t *snap, const char *str, uint32_t *off)
+{
+    size_t len = strlen(str) + 1;
+
+    if (snap->strs_len + len > snap->strs_cap) {
+        size_t cap = snap->strs_cap ? snap->strs_cap * 2 : 64 * 1024;
+        while (cap < snap->strs_len + len) cap *= 2;
+
+        char *p = realloc(snap->strs, cap);
+        if (p == NULL) {
+            return -1;
+        }
+        snap->strs = p;
+        snap->strs_cap = cap;
+    }
+
+    memcpy(snap->strs + snap->strs_len, str, len);
+    *off = snap->strs_len;
+    snap->strs_len += len;
+    return 0;
+}
+
+static int set_fields(dir_snapshot_t *snap, snap_entry_t *se, const dir_entry_t *e)
+{
+    se->ino = e->ino;
+    se->atime = e->atime;
+    se->mtime = e->mtime;
+    se->ctime = e->ctime;
+    se->size = e->size;
+    se->mode = e->mode;
+    se->uid = e->uid;
+    se->gid = e->gid;
+    se->nlink = e->nlink;
+    se->d_type = e->d_type;
+    se->removed = 0;
+
+    // 링크 대상이 같으면 풀에 있는 문자열을 그대로 쓴다
+    if (e->link == NULL) {
+        se->link_off = SNAP_NO_LINK;
+    } else if (se->link_off == SNAP_NO_LINK || strcmp(snap->strs + se->link_off, e->link) != 0) {
+        return add_str(snap, e->link, &se->link_off);
+    }
+    return 0;
+}
+
+/* 새 이름의 항목을 추가한다 (스캔으로 스냅샷을 만들 때) */
+int snapshot_put(dir_snapshot_t *snap, const dir_entry_t *e)
+{
+    if ((snap->count + 1) * 10 > snap->hash_size * 7 && hash_grow(snap) < 0) {
+        return -1;
+    }
+    if (snap->count == snap->cap) {
+        uint32_t cap = snap->cap ? snap->cap * 2 : 1024;
+        snap_entry_t *p = realloc(snap->ent, sizeof(snap_entry_t) * cap);
+        if (p == NULL) {
+            return -1;
+        }
+        snap->ent = p;
+        snap->cap = cap;
+    }
+
+    snap_entry_t *se = &snap->ent[snap->count];
+    memset(se, 0, sizeof(*se));
+    se->link_off = SNAP_NO_LINK;
+    if (add_str(snap, e->name, &se->name_off) < 0 || set_fields(snap, se, e) < 0) {
+        return -1;
+    }
+
+    uint32_t mask = snap->hash_size - 1;
+    uint32_t h = name_hash(e->name) & mask;
+    while (snap->hash[h]) h = (h + 1) & mask;
+    snap->hash[h] = snap->count + 1;
+
+    snap->count++;
+    snap->live++;
+    return 0;
+}
+
+/* 항목 하나의 현재 상태를 반영한다 (e == NULL 이면 지워짐).
+ * 바뀐 내용을 '+' (추가), '-' (삭제), '~' (변경) 로 돌려주고, 그대로면 0, 오류면 -1 */
+int snapshot_update(dir_snapshot_t *snap, const char *name, const dir_entry_t *e)
+{
+    snap_entry_t *se = snapshot_find(snap, name);
+
+    if (e == NULL) {
+        if (se == NULL || se->removed) {
+            return 0;
+        }
+        se->removed = 1;
+        snap->live--;
+        return '-';
+    }
+
+    if (se == NULL) {
+        return snapshot_put(snap, e) < 0 ? -1 : '+';
+    }
+
+    if (se->removed) {
+        snap->live++;
+        return set_fields(snap, se, e) < 0 ? -1 : '+';
+    }
+
+    // 바뀐 게 없으면 알릴 필요 없음
+    snap_entry_t tmp = *se;
+    if (set_fields(snap, &tmp, e) < 0) {
+        return -1;
+    }
+    int changed = snapshot_differs(snap, se, snap, &tmp);
+    *se = tmp;
+    return changed ? '~' : 0;
+}
+
+/* 목록 한 줄로 만들 수 있도록 dir_entry_t 로 옮긴다 (문자열은 스냅샷 안을 가리킴) */
+void snapshot_entry(const dir_snapshot_t *snap, const snap_entry_t *se, dir_entry_t *e)
+{
+    e->ino = se->ino;
+    e->d_type = se->d_type;
+    e->mode = se->mode;
+    e->uid = se->uid;
+    e->gid = se->gid;
+    e->atime = se->atime;
+    e->mtime = se->mtime;
+    e->ctime = se->ctime;
+    e->nlink = se->nlink;
+    e->size = se->size;
+    e->link = se->link_off == SNAP_NO_LINK ? NULL : snap->strs + se->link_off;
+    snprintf(e->name, sizeof(e->name), "%s", snap->strs + se->name_off);
+}
+
+/* 클라이언트에 다시 보내야 할 만큼 다른지. 읽기만 해도 바뀌는 atime 은 보지 않는다 */
+int snapshot_differs(const dir_snapshot_t *a, const snap_entry_t *ea,
+                     const dir_snapshot_t *b, const snap_entry_t *eb)
+{
+    if (ea->ino != eb->ino || ea->mode != eb->mode || ea->uid != eb->uid || ea->gid != eb->gid ||
+        ea->mtime != eb->mtime || ea->ctime != eb->ctime || ea->nlink != eb->nlink ||
+        ea->size != eb->size || ea->d_type != eb->d_type) {
+        return 1;
+    }
+    if ((ea->link_off == SNAP_NO_LINK) != (eb->link_off == SNAP_NO_LINK)) {
+        return 1;
+    }
+    return ea->link_off != SNAP_NO_LINK && strcmp(a->strs + ea->link_off, b->strs + eb->link_off) != 0;
+}
@@ -0,0 +1,78 @@
+#ifndef MYSH_SNAPSHOT_H
+#define MYSH_SNAPSHOT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "dirscan.h"
+
+/* 스냅샷에 들고 있는 항목 하나 (문자열은 strs 풀 안) */
+typedef struct snap_entry {
+    uint64_t    ino;
+    int64_t     atime;
+    int64_t     mtime;
+    int64_t     ctime;
+    int64_t     size;
+    uint32_t    mode;
+    uint32_t    uid;
+    uint32_t    gid;
+    uint32_t    nlink;
+    uint32_t    name_off;
+    uint32_t    link_off;           // SNAP_NO_LINK 이면 심볼릭 링크 아님
+    uint8_t     d_type;
+    uint8_t     removed;            // 지워진 항목 (이름이 다시 생기면 재사용)
+    uint8_t     mark;               // 비교할 때 쓰는 표시
+} snap_entry_t;
+
+#define SNAP_NO_LINK    (UINT32_MAX)
+
+/* 스냅샷으로 한 번 만들어 둔 목록 바이트. 같은 스냅샷이면 다시 포맷하지 않고 그대로 보낸다 */
+enum snap_blob_kind {
+    SNAP_BLOB_LIST,                 // ls (스냅샷 순서)
+    SNAP_BLOB_NAMES,                // ls -n
+    SNAP_BLOB_BY_NAME,              // ls -w ... name/size/mtime (LS_SORT_* 순서와 같음)
+    SNAP_BLOB_BY_SIZE,
+    SNAP_BLOB_BY_MTIME,
+    SNAP_BLOB_RECORDS,              // 위 목록들의 FT_RECORDS 형식 (같은 순서)
+    SNAP_BLOB_REC_BY_NAME = SNAP_BLOB_RECORDS + 2,
+    SNAP_BLOB_KINDS = SNAP_BLOB_REC_BY_NAME + 3,
+};
+
+typedef struct snap_blob {
+    char       *buf;                // 텍스트 목록, 또는 FT_RECORDS 레코드 배열
+    size_t      len;
+    size_t     *row_off;            // 행 i 의 시작 위치 (레코드 형식이면 strs 안의 위치, rows + 1 개)
+    char       *strs;               // 레코드 형식의 문자열 테이블
+    uint32_t    rows;
+} snap_blob_t;
+
+/* 디렉토리 하나의 항목 전체와 그 버전 */
+typedef struct dir_snapshot {
+    dev_t       dev;                // 어떤 디렉토리의 스냅샷인지
+    ino_t       ino;
+    uint32_t    version;
+    uint32_t    refs;               // snapshot_free 는 마지막 참조에서만 해제
+    uint32_t    live;               // 지워지지 않은 항목 수
+    snap_entry_t *ent;
+    uint32_t    count;
+    uint32_t    cap;
+    char       *strs;
+    size_t      strs_len;
+    size_t      strs_cap;
+    uint32_t   *hash;               // 이름 -> ent 인덱스 + 1 (0 은 빈 칸)
+    uint32_t    hash_size;
+    snap_blob_t *blobs[SNAP_BLOB_KINDS]; // 캐시된 (바뀌지 않는) 스냅샷에만 붙인다
+} dir_snapshot_t;
+
+dir_snapshot_t *snapshot_new(dev_t dev, ino_t ino);
+void snapshot_free(dir_snapshot_t *snap);
+dir_snapshot_t *snapshot_ref(dir_snapshot_t *snap);
+dir_snapshot_t *snapshot_clone(const dir_snapshot_t *snap);
+size_t snapshot_bytes(const dir_snapshot_t *snap);
+int  snapshot_put(dir_snapshot_t *snap, const dir_entry_t *e);
+int  snapshot_update(dir_snapshot_t *snap, const char *name, const dir_entry_t *e);
+snap_entry_t *snapshot_find(dir_snapshot_t *snap, const char *name);
+void snapshot_entry(const dir_snapshot_t *snap, const snap_entry_t *se, dir_entry_t *e);
+int  snapshot_differs(const dir_snapshot_t *a, const snap_entry_t *ea,
+                      const dir_snapshot_t *b, const snap_entry_t *eb);
+
+#endif // MYSH_SNAPSHOT_H
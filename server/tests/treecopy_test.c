@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../treecopy.h"
+
+static int failed;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failed++; \
+        } \
+    } while (0)
+
+static void make_file(int dfd, const char *path, const char *data)
+{
+    int fd = openat(dfd, path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0 || write(fd, data, strlen(data)) < 0) {
+        perror(path);
+        exit(1);
+    }
+    close(fd);
+}
+
+static int file_is(int dfd, const char *path, const char *data)
+{
+    char buf[256];
+    int  fd = openat(dfd, path, O_RDONLY | O_NOFOLLOW);
+    ssize_t n = fd < 0 ? -1 : read(fd, buf, sizeof(buf) - 1);
+
+    if (fd >= 0) close(fd);
+    if (n < 0) return 0;
+    buf[n] = '\0';
+    return strcmp(buf, data) == 0;
+}
+
+/* 원본 자신이나 그 아래로는 복사하지 않는다 (대상이 아직 없어도, ".." 가 섞여 있어도) */
+static void test_contains(int root)
+{
+    mkdirat(root, "src", 0755);
+    mkdirat(root, "src/sub", 0755);
+    mkdirat(root, "src/sub/deep", 0755);
+    mkdirat(root, "other", 0755);
+    symlinkat("src/sub", root, "alias");
+
+    CHECK(tree_contains(root, "src", root, "src") == 1);
+    CHECK(tree_contains(root, "src", root, "src/new") == 1);
+    CHECK(tree_contains(root, "src", root, "src/sub/deep/new") == 1);
+    CHECK(tree_contains(root, "src", root, "other/../src/sub/new") == 1);
+    CHECK(tree_contains(root, "src", root, "alias/new") == 1);
+    CHECK(tree_contains(root, "src/sub", root, "src/sub/deep") == 1);
+
+    CHECK(tree_contains(root, "src", root, "other/new") == 0);
+    CHECK(tree_contains(root, "src", root, "srcnew") == 0);
+    CHECK(tree_contains(root, "src/sub", root, "src/new") == 0);
+    CHECK(tree_contains(root, "src", root, "missing/new") == 0);
+    make_file(root, "file", "x");
+    CHECK(tree_contains(root, "file", root, "file2") == 0);
+}
+
+/* 트리 안의 링크는 따라가지 않고 링크로 만들고, 읽기 전용 디렉토리도 복사한다 */
+static void test_copy(int root)
+{
+    tree_copy_stats_t st;
+    char target[64];
+    ssize_t n;
+    struct stat sb;
+
+    mkdirat(root, "t", 0755);
+    mkdirat(root, "t/a", 0755);
+    mkdirat(root, "t/a/b", 0755);
+    mkdirat(root, "t/ro", 0755);
+    make_file(root, "t/top", "top");
+    make_file(root, "t/a/b/leaf", "leaf");
+    make_file(root, "t/ro/k", "k");
+    symlinkat("..", root, "t/a/up");
+    symlinkat("/", root, "t/a/b/rootlink");
+    fchmodat(root, "t/ro", 0555, 0);
+
+    CHECK(tree_copy(root, "t", root, "t2", &st, NULL) == 0);
+    CHECK(st.errors == 0);
+    CHECK(st.dirs == 4);
+    CHECK(st.files == 5);
+    tree_copy_stats_free(&st);
+
+    CHECK(file_is(root, "t2/top", "top"));
+    CHECK(file_is(root, "t2/a/b/leaf", "leaf"));
+    CHECK(file_is(root, "t2/ro/k", "k"));
+    n = readlinkat(root, "t2/a/up", target, sizeof(target) - 1);
+    CHECK(n == 2 && memcmp(target, "..", 2) == 0);
+    n = readlinkat(root, "t2/a/b/rootlink", target, sizeof(target) - 1);
+    CHECK(n == 1 && target[0] == '/');
+    CHECK(fstatat(root, "t2/ro", &sb, 0) == 0 && (sb.st_mode & 07777) == 0555);
+
+    // 이미 있는 대상 위로 다시 복사하면 링크도 덮어쓴다
+    CHECK(tree_copy(root, "t", root, "t2", &st, NULL) == 0);
+    tree_copy_stats_free(&st);
+
+    fchmodat(root, "t/ro", 0755, 0);
+    fchmodat(root, "t2/ro", 0755, 0);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/treecopy_test.XXXXXX";
+    char cmd[64];
+    int  root;
+
+    if (mkdtemp(dir) == NULL || (root = open(dir, O_RDONLY | O_DIRECTORY)) < 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_contains(root);
+    test_copy(root);
+
+    close(root);
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "cleanup %s failed\n", dir);
+    }
+
+    printf("treecopy_test: %s\n", failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../treerm.h"
+
+static int failed;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failed++; \
+        } \
+    } while (0)
+
+static void make_file(int dfd, const char *path)
+{
+    int fd = openat(dfd, path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    close(fd);
+}
+
+/* 트리 안의 링크는 따라가지 않는다 (링크가 가리키는 바깥 디렉토리는 남는다) */
+static void test_remove(int root)
+{
+    tree_remove_stats_t st;
+    char name[32];
+
+    mkdirat(root, "keep", 0755);
+    make_file(root, "keep/k");
+    mkdirat(root, "t", 0755);
+    for (int i = 0; i < 8; i++) {
+        snprintf(name, sizeof(name), "t/d%d", i);
+        mkdirat(root, name, 0755);
+        snprintf(name, sizeof(name), "t/d%d/e", i);
+        mkdirat(root, name, 0755);
+        snprintf(name, sizeof(name), "t/d%d/e/f", i);
+        make_file(root, name);
+    }
+    symlinkat("../keep", root, "t/out");
+    symlinkat("../../keep", root, "t/d0/e/out");
+
+    CHECK(tree_remove(root, "t", &st, NULL) == 0);
+    CHECK(st.errors == 0);
+    CHECK(st.dirs == 17);
+    CHECK(st.files == 10);
+    tree_remove_stats_free(&st);
+
+    CHECK(faccessat(root, "t", F_OK, AT_SYMLINK_NOFOLLOW) < 0);
+    CHECK(faccessat(root, "keep/k", F_OK, 0) == 0);
+}
+
+/* 지울 수 없는 항목이 있으면 그 위쪽 디렉토리만 남기고 나머지는 지운다 */
+static void test_partial(int root)
+{
+    tree_remove_stats_t st;
+
+    mkdirat(root, "p", 0755);
+    mkdirat(root, "p/locked", 0755);
+    make_file(root, "p/locked/f");
+    mkdirat(root, "p/free", 0755);
+    make_file(root, "p/free/f");
+    fchmodat(root, "p/locked", 0555, 0);
+
+    if (geteuid() != 0) {   // root 는 권한과 상관없이 지운다
+        CHECK(tree_remove(root, "p", &st, NULL) < 0);
+        CHECK(st.errors >= 1);
+        tree_remove_stats_free(&st);
+        CHECK(faccessat(root, "p/locked/f", F_OK, 0) == 0);
+        CHECK(faccessat(root, "p/free", F_OK, 0) < 0);
+    }
+    fchmodat(root, "p/locked", 0755, 0);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/treerm_test.XXXXXX";
+    char cmd[64];
+    int  root;
+
+    if (mkdtemp(dir) == NULL || (root = open(dir, O_RDONLY | O_DIRECTORY)) < 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_remove(root);
+    test_partial(root);
+
+    close(root);
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "cleanup %s failed\n", dir);
+    }
+
+    printf("treerm_test: %s\n", failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
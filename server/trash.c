@@ -0,0 +1,419 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "trash.h"
+#include "treerm.h"
+
+// linux/ioprio.h 의 값 (glibc 에 래퍼가 없음)
+#define IOPRIO_WHO_PROCESS  (1)
+#define IOPRIO_CLASS_IDLE   (3)
+#define IOPRIO_CLASS_SHIFT  (13)
+
+#define PURGE_PREFIX        "purge."
+#define INFO_SUFFIX         ".info"
+
+/* 휴지통 안의 이름 하나 (항목, info, 비우는 중인 항목) */
+typedef struct trash_item {
+    char       *name;
+    time_t      when;           // 지운 시각 (이름에서)
+    unsigned    seq;
+} trash_item_t;
+
+static int      trash_fd = -1;
+static long     keep_sec = TRASH_KEEP_SEC;
+static unsigned next_seq;                   // trash_put 은 이벤트 루프에서만 부른다
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake = PTHREAD_COND_INITIALIZER;
+static int      purge_all;                  // trash_empty 요청 (wake_lock)
+
+/* 비우는 스레드의 속도 제한. tree_remove 의 작업 스레드들이 같이 쓴다 */
+static pthread_mutex_t throttle_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec slice_start;
+static uint64_t slice_count;
+
+static int has_prefix(const char *s, const char *prefix)
+{
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+static int has_suffix(const char *s, const char *suffix)
+{
+    size_t n = strlen(s), m = strlen(suffix);
+
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+/* 사용자가 준 id 가 휴지통 항목의 이름인지 (경로, info, 비우는 중인 이름은 안 됨) */
+static int valid_id(const char *id)
+{
+    return id[0] != '\0' && id[0] != '.' && strlen(id) < TRASH_ID_SIZE && strchr(id, '/') == NULL &&
+           !has_prefix(id, PURGE_PREFIX) && !has_suffix(id, INFO_SUFFIX);
+}
+
+/* "<지운 시각>-<번호>". 모르는 이름은 아주 오래된 것으로 본다 */
+static time_t id_time(const char *id, unsigned *seq)
+{
+    char *end;
+    long long t = strtoll(id, &end, 10);
+
+    if (*end != '-') {
+        if (seq) *seq = 0;
+        return 0;
+    }
+    if (seq) *seq = strtoul(end + 1, NULL, 10);
+    return (time_t)t;
+}
+
+/* 대상이 이미 있으면 EEXIST. RENAME_NOREPLACE 를 지원하지 않는 파일 시스템에서는 확인 후 rename */
+static int move_noreplace(int odfd, const char *old, int ndfd, const char *new)
+{
+    struct stat st;
+
+    if (renameat2(odfd, old, ndfd, new, RENAME_NOREPLACE) == 0) {
+        return 0;
+    }
+    if (errno != EINVAL) {
+        return -1;
+    }
+    if (fstatat(ndfd, new, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+    return renameat(odfd, old, ndfd, new);
+}
+
+int trash_put(int dfd, const char *rel, const char *origin, char *id, size_t size)
+{
+    char info[TRASH_ID_SIZE + sizeof(INFO_SUFFIX)];
+    int  fd, len = strlen(origin);
+
+    if (trash_fd < 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // 같은 초에 지운 것이나 이전 실행에서 남은 것과 겹치면 번호를 올린다
+    while (1) {
+        snprintf(id, size, "%lld-%u", (long long)time(NULL), ++next_seq);
+        if (move_noreplace(dfd, rel, trash_fd, id) == 0) {
+            break;
+        }
+        if (errno != EEXIST) {
+            return -1;
+        }
+    }
+
+    // 항목은 이미 옮겨졌다. info 가 없으면 복구할 때 경로를 직접 줘야 할 뿐
+    snprintf(info, sizeof(info), "%s" INFO_SUFFIX, id);
+    fd = openat(trash_fd, info, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0 || write(fd, origin, len) != len) {
+        perror("trash info");
+    }
+    if (fd >= 0) close(fd);
+    return 0;
+}
+
+int trash_origin(const char *id, char *origin, size_t size)
+{
+    char    info[TRASH_ID_SIZE + sizeof(INFO_SUFFIX)];
+    ssize_t n;
+    int     fd;
+
+    if (trash_fd < 0 || !valid_id(id)) {
+        errno = ENOENT;
+        return -1;
+    }
+    snprintf(info, sizeof(info), "%s" INFO_SUFFIX, id);
+    if ((fd = openat(trash_fd, info, O_RDONLY | O_CLOEXEC)) < 0) {
+        return -1;
+    }
+    n = read(fd, origin, size - 1);
+    close(fd);
+    if (n <= 0) {
+        errno = n == 0 ? ENODATA : EIO;
+        return -1;
+    }
+    origin[n] = '\0';
+    return 0;
+}
+
+int trash_restore(const char *id, int dfd, const char *rel)
+{
+    char info[TRASH_ID_SIZE + sizeof(INFO_SUFFIX)];
+
+    if (trash_fd < 0 || !valid_id(id)) {
+        errno = ENOENT;
+        return -1;
+    }
+    // 비우는 스레드가 먼저 purge.<id> 로 가져갔으면 ENOENT
+    if (move_noreplace(trash_fd, id, dfd, rel) < 0) {
+        return -1;
+    }
+    snprintf(info, sizeof(info), "%s" INFO_SUFFIX, id);
+    unlinkat(trash_fd, info, 0);
+    return 0;
+}
+
+int trash_format(const char *id, const char *origin, char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "%s %lld %s\n", id, (long long)id_time(id, NULL), origin);
+
+    return len < (int)size ? len : (int)size - 1;
+}
+
+static int item_cmp(const void *a, const void *b)
+{
+    const trash_item_t *x = a, *y = b;
+
+    if (x->when != y->when) {
+        return x->when < y->when ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static void free_items(trash_item_t *items, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        free(items[i].name);
+    }
+    free(items);
+}
+
+/* 휴지통 안의 이름 전부 (오래된 것부터). 디렉토리를 다 읽은 뒤에 이름을 바꾸도록 먼저 모은다 */
+static trash_item_t *scan_items(size_t *count)
+{
+    int   fd = trash_fd >= 0 ? openat(trash_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+    DIR  *dir = fd >= 0 ? fdopendir(fd) : NULL;
+    trash_item_t *items = NULL, *p;
+    size_t n = 0, cap = 0;
+    struct dirent *d;
+
+    *count = 0;
+    if (dir == NULL) {
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    while ((d = readdir(dir)) != NULL) {
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) {
+            continue;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            if ((p = realloc(items, sizeof(trash_item_t) * cap)) == NULL) {
+                break;
+            }
+            items = p;
+        }
+        if ((items[n].name = strdup(d->d_name)) == NULL) {
+            break;
+        }
+        items[n].when = id_time(d->d_name + (has_prefix(d->d_name, PURGE_PREFIX) ? strlen(PURGE_PREFIX) : 0),
+                                &items[n].seq);
+        n++;
+    }
+    closedir(dir);
+
+    if (n > 0) {
+        qsort(items, n, sizeof(trash_item_t), item_cmp);
+    }
+    *count = n;
+    return items;
+}
+
+char *trash_list(size_t *len)
+{
+    char   *buf = NULL;
+    char    origin[PATH_MAX];
+    char    line[PATH_MAX + 64];
+    size_t  n;
+    FILE   *fp = open_memstream(&buf, len);
+    trash_item_t *items;
+
+    if (fp == NULL) {
+        return NULL;
+    }
+    items = scan_items(&n);
+    for (size_t i = 0; i < n; i++) {
+        if (has_prefix(items[i].name, PURGE_PREFIX) || has_suffix(items[i].name, INFO_SUFFIX)) {
+            continue;
+        }
+        if (trash_origin(items[i].name, origin, sizeof(origin)) < 0) {
+            snprintf(origin, sizeof(origin), "?");
+        }
+        fwrite(line, 1, trash_format(items[i].name, origin, line, sizeof(line)), fp);
+    }
+    free_items(items, n);
+
+    if (fclose(fp) != 0) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/* 비우는 스레드의 progress. 100ms 동안 TRASH_REAP_RATE / 10 개를 넘게 지웠으면 남은 시간만큼 잔다.
+ * 잠금을 잡은 채로 자므로 다른 작업 스레드도 다음 항목에서 같이 멈춘다 */
+static void throttle(void *arg, uint64_t files, uint64_t bytes)
+{
+    struct timespec now, rest = { 0, 0 };
+    long elapsed;
+
+    (void)arg;
+    (void)bytes;
+    pthread_mutex_lock(&throttle_lock);
+    slice_count += files;
+    if (slice_count >= TRASH_REAP_RATE / 10) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - slice_start.tv_sec) * 1000000000L + (now.tv_nsec - slice_start.tv_nsec);
+        if (elapsed < 100000000L) {
+            rest.tv_nsec = 100000000L - elapsed;
+            nanosleep(&rest, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &slice_start);
+        slice_count = 0;
+    }
+    pthread_mutex_unlock(&throttle_lock);
+}
+
+static void purge(const char *name)
+{
+    copy_ctl_t ctl = { .progress = throttle };
+    tree_remove_stats_t st;
+
+    pthread_mutex_lock(&throttle_lock);
+    clock_gettime(CLOCK_MONOTONIC, &slice_start);
+    slice_count = 0;
+    pthread_mutex_unlock(&throttle_lock);
+
+    if (tree_remove(trash_fd, name, &st, &ctl) < 0) {
+        for (int i = 0; i < st.nmsg; i++) {
+            fprintf(stderr, "trash: %s\n", st.msg[i]);
+        }
+    }
+    printf("trash: purged %s (%llu files, %llu dirs)\n", name,
+           (unsigned long long)st.files, (unsigned long long)st.dirs);
+    tree_remove_stats_free(&st);
+}
+
+/* 보관 기간이 지난 항목 (all 이면 전부) 을 지운다. 복구와 겹치지 않게 먼저 purge.<id> 로 바꾼다 */
+static void reap(int all)
+{
+    time_t now = time(NULL);
+    char   name[NAME_MAX + 1];
+    size_t n;
+    trash_item_t *items = scan_items(&n);
+    struct stat st;
+
+    for (size_t i = 0; i < n; i++) {
+        const char *item = items[i].name;
+
+        if (has_suffix(item, INFO_SUFFIX)) {
+            // 항목은 복구됐는데 info 만 남은 것
+            snprintf(name, sizeof(name), "%.*s", (int)(strlen(item) - strlen(INFO_SUFFIX)), item);
+            if (fstatat(trash_fd, name, &st, AT_SYMLINK_NOFOLLOW) < 0 && errno == ENOENT) {
+                unlinkat(trash_fd, item, 0);
+            }
+            continue;
+        }
+        if (has_prefix(item, PURGE_PREFIX)) {
+            purge(item);    // 지우다가 서버가 멈춘 것
+            continue;
+        }
+        if (!all && items[i].when + keep_sec > now) {
+            continue;
+        }
+
+        snprintf(name, sizeof(name), PURGE_PREFIX "%s", item);
+        if (renameat(trash_fd, item, trash_fd, name) < 0) {
+            continue;       // 그새 복구됨
+        }
+        purge(name);
+        snprintf(name, sizeof(name), "%s" INFO_SUFFIX, item);
+        unlinkat(trash_fd, name, 0);
+    }
+    free_items(items, n);
+}
+
+static void *reaper_main(void *arg)
+{
+    struct timespec until;
+    int all = 0;
+
+    (void)arg;
+    // 이 스레드와 tree_remove 가 만드는 작업 스레드 (우선순위를 물려받음) 는 남는 CPU 와 디스크만 쓴다
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19) < 0 ||
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) < 0) {
+        perror("trash reaper priority");
+    }
+
+    while (1) {
+        reap(all);
+
+        pthread_mutex_lock(&wake_lock);
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += TRASH_SCAN_SEC;
+        while (!purge_all && pthread_cond_timedwait(&wake, &wake_lock, &until) != ETIMEDOUT) {
+            ;
+        }
+        all = purge_all;
+        purge_all = 0;
+        pthread_mutex_unlock(&wake_lock);
+    }
+    return NULL;
+}
+
+void trash_empty(void)
+{
+    pthread_mutex_lock(&wake_lock);
+    purge_all = 1;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&wake_lock);
+}
+
+int trash_init(int root_fd, const char *chroot_path)
+{
+    char path[PATH_MAX];
+    struct stat rst, tst;
+    const char *env = getenv("MYSH_TRASH_KEEP");
+    pthread_t tid;
+    int err;
+
+    if (env) {
+        keep_sec = strtol(env, NULL, 10);
+    }
+
+    // chroot 옆 ("<chroot>.trash") 에 두어 클라이언트가 보거나 건드릴 수 없게 한다.
+    // 다른 파일 시스템이면 rename 으로 옮길 수 없으므로 휴지통 없이 (rm -t 는 ENOTSUP)
+    snprintf(path, sizeof(path), "%s.trash", chroot_path);
+    mkdir(path, 0700);
+    trash_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (trash_fd < 0) {
+        perror("open trash");
+        return -1;
+    }
+    if (fstat(root_fd, &rst) < 0 || fstat(trash_fd, &tst) < 0 || rst.st_dev != tst.st_dev) {
+        fprintf(stderr, "trash: %s is not on the same file system as %s, rm -t disabled\n", path, chroot_path);
+        close(trash_fd);
+        trash_fd = -1;
+        return -1;
+    }
+
+    if ((err = pthread_create(&tid, NULL, reaper_main, NULL)) != 0) {
+        errno = err;
+        perror("trash reaper");     // 옮기기와 복구는 되고, 비우지만 않는다
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
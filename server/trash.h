@@ -0,0 +1,25 @@
+#ifndef MYSH_TRASH_H
+#define MYSH_TRASH_H
+
+#include <stddef.h>
+
+#define TRASH_KEEP_SEC      (24 * 60 * 60)  // 휴지통 보관 기간 기본값 (MYSH_TRASH_KEEP 로 바꿈, 초)
+#define TRASH_SCAN_SEC      (60)            // 비우는 스레드가 기간이 지난 항목을 찾는 간격
+#define TRASH_REAP_RATE     (20000)         // 비우는 스레드가 1초에 지우는 최대 항목 수
+#define TRASH_ID_SIZE       (32)
+
+/* chroot 옆 ("<chroot>.trash") 의 휴지통. chroot 와 같은 파일 시스템일 때만 쓴다.
+ * 옮기는 것은 rename 한 번이라 크기와 상관없이 바로 끝나고, 실제로 지우는 것은
+ * 낮은 우선순위 스레드가 보관 기간이 지난 뒤에 천천히 한다.
+ *
+ * 휴지통 안에는 "<지운 시각>-<번호>" 이름으로 옮긴 항목과, 원래 경로를 적은 "<id>.info" 가 있다.
+ * 비우는 중인 항목은 "purge.<id>" 로 이름을 바꿔 두므로 복구와 겹치지 않는다 */
+int  trash_init(int root_fd, const char *chroot_path);    // 휴지통을 열고 비우는 스레드 시작
+int  trash_put(int dfd, const char *rel, const char *origin, char *id, size_t size);   // origin: chroot 기준 경로
+int  trash_origin(const char *id, char *origin, size_t size);
+int  trash_restore(const char *id, int dfd, const char *rel);
+int  trash_format(const char *id, const char *origin, char *buf, size_t size);  // "<id> <지운 시각> <원래 경로>\n"
+char *trash_list(size_t *len);      // 휴지통 전체를 trash_format 줄로 (오래된 것부터, free 필요)
+void trash_empty(void);             // 보관 기간과 상관없이 지금 전부 비운다
+
+#endif // MYSH_TRASH_H
@@ -0,0 +1,441 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "treecopy.h"
+#include "workq.h"
+
+/* 복사 중인 디렉토리 하나. 원본/대상을 열어 두고 자식은 이 fd 들 기준으로 연다 (중간 경로를 다시 따라가지 않게).
+ * 자기를 읽는 작업, 남은 자식 작업, 하위 디렉토리가 참조를 하나씩 잡고 있고,
+ * 마지막 참조가 풀리면 (아래가 다 복사되면) 원래 권한으로 바꾸고 닫는다 */
+typedef struct copy_dir {
+    struct copy_dir *parent;    // NULL 이면 맨 위
+    long        refs;           // 원자적
+    DIR        *src;            // 자식은 dirfd(src) 기준
+    int         dst;
+    mode_t      mode;
+} copy_dir_t;
+
+/* 작업 하나: 디렉토리 하나를 읽어서 자식 작업을 만들거나, 파일 하나를 복사 */
+typedef struct copy_task {
+    copy_dir_t *parent;         // 참조 하나를 잡고 있다. NULL 이면 맨 위 디렉토리
+    int         is_dir;
+    const char *name;           // parent 안의 이름 (rel 의 마지막 요소)
+    char        rel[];          // 복사하는 트리의 맨 위 기준 경로 (오류 메시지용. "" 이면 맨 위)
+} copy_task_t;
+
+typedef struct tree_copy {
+    int         sroot;          // 원본/대상 트리의 맨 위 디렉토리
+    int         droot;
+    pthread_mutex_t lock;       // 결과 기록
+    tree_copy_stats_t *st;
+    const copy_ctl_t *ctl;      // NULL 이면 진행 상황 보고와 취소 없음
+} tree_copy_t;
+
+static void record_error(tree_copy_t *tc, const char *rel, int err)
+{
+    pthread_mutex_lock(&tc->lock);
+    tc->st->errors++;
+    if (tc->st->nmsg < TREECOPY_MAX_ERRORS &&
+        asprintf(&tc->st->msg[tc->st->nmsg], "%s: %s", *rel ? rel : ".", strerror(err)) >= 0) {
+        tc->st->nmsg++;
+    }
+    pthread_mutex_unlock(&tc->lock);
+}
+
+/* 참조 하나를 푼다. 마지막이면 원래 권한으로 바꾸고 부모로 올라간다 (자식부터 바뀌므로
+ * 부모에서 쓰기 권한을 빼도 자식은 이미 다 만들어져 있다) */
+static void dir_put(copy_dir_t *dir)
+{
+    while (dir && __atomic_sub_fetch(&dir->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        copy_dir_t *parent = dir->parent;
+
+        fchmod(dir->dst, dir->mode & 07777);
+        closedir(dir->src);
+        close(dir->dst);
+        free(dir);
+        dir = parent;
+    }
+}
+
+/* 작업 큐에 디렉토리 또는 파일 작업을 넣는다. 작업은 dir 의 참조를 하나 잡는다 */
+static void submit(workq_t *wq, int self, copy_dir_t *dir, const char *rel, int is_dir)
+{
+    tree_copy_t *tc = workq_arg(wq);
+    size_t len = strlen(rel) + 1;
+    const char *slash = strrchr(rel, '/');
+    copy_task_t *task = malloc(sizeof(copy_task_t) + len);
+
+    if (task != NULL) {
+        task->parent = dir;
+        task->is_dir = is_dir;
+        memcpy(task->rel, rel, len);
+        task->name = task->rel + (slash ? slash - rel + 1 : 0);
+        __atomic_add_fetch(&dir->refs, 1, __ATOMIC_RELAXED);
+    }
+    if (task == NULL || workq_submit(wq, self, task) < 0) {
+        record_error(tc, rel, ENOMEM);
+        if (task != NULL) {
+            __atomic_sub_fetch(&dir->refs, 1, __ATOMIC_RELAXED);    // 호출한 쪽이 참조를 잡고 있어서 0 이 되지 않음
+        }
+        free(task);
+    }
+}
+
+static void join_path(char *buf, size_t size, const char *dir, const char *name)
+{
+    snprintf(buf, size, "%s%s%s", dir, *dir ? "/" : "", name);
+}
+
+/* 대상 디렉토리를 만든다. 원래 권한은 자식까지 다 만든 뒤에 dir_put 에서 돌려 놓는다 */
+static int make_dir(tree_copy_t *tc, copy_dir_t *parent, const char *name, mode_t mode)
+{
+    if (mkdirat(parent->dst, name, (mode & 07777) | S_IRWXU) < 0 && errno != EEXIST) {
+        return -1;
+    }
+    __atomic_add_fetch(&tc->st->dirs, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* 디렉토리를 한 번 읽으면서 하위 디렉토리는 만들고 (부모가 먼저), 파일은 작업으로 넘긴다 */
+static void copy_dir(workq_t *wq, int self, copy_task_t *task)
+{
+    tree_copy_t *tc = workq_arg(wq);
+    copy_dir_t *parent = task->parent;
+    char child[PATH_MAX];
+    struct dirent *entry;
+    struct stat st;
+    copy_dir_t *dir;
+    int sfd, dfd;
+
+    // 부모 fd 기준으로 한 단계만 연다. 그 사이에 링크로 바뀌었으면 따라가지 않는다
+    if (parent) {
+        sfd = openat(dirfd(parent->src), task->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        dfd = sfd < 0 ? -1 : openat(parent->dst, task->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    } else {
+        sfd = fcntl(tc->sroot, F_DUPFD_CLOEXEC, 0);
+        dfd = sfd < 0 ? -1 : fcntl(tc->droot, F_DUPFD_CLOEXEC, 0);
+    }
+    dir = dfd < 0 ? NULL : calloc(1, sizeof(copy_dir_t));
+    if (dir == NULL || fstat(sfd, &st) < 0 || (dir->src = fdopendir(sfd)) == NULL) {
+        record_error(tc, task->rel, dfd >= 0 && dir == NULL ? ENOMEM : errno);
+        if (sfd >= 0) close(sfd);
+        if (dfd >= 0) close(dfd);
+        free(dir);
+        return;
+    }
+    dir->parent = parent;
+    dir->refs = 1;          // 읽는 동안 자기 참조
+    dir->dst = dfd;
+    dir->mode = st.st_mode;
+    if (parent) {
+        __atomic_add_fetch(&parent->refs, 1, __ATOMIC_RELAXED);
+    }
+
+    while ((entry = readdir(dir->src)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        join_path(child, sizeof(child), task->rel, entry->d_name);
+
+        // 링크나 타입을 모르는 항목은 파일 작업에서 보고 정한다
+        if (entry->d_type != DT_DIR) {
+            submit(wq, self, dir, child, 0);
+            continue;
+        }
+        if (fstatat(dirfd(dir->src), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0 ||
+            make_dir(tc, dir, entry->d_name, st.st_mode) < 0) {
+            record_error(tc, child, errno);
+            continue;
+        }
+        submit(wq, self, dir, child, 1);
+    }
+    dir_put(dir);
+}
+
+static void copied(tree_copy_t *tc, uint64_t bytes)
+{
+    __atomic_add_fetch(&tc->st->files, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&tc->st->bytes, bytes, __ATOMIC_RELAXED);
+    if (tc->ctl && tc->ctl->progress) {
+        tc->ctl->progress(tc->ctl->arg, 1, 0);
+    }
+}
+
+/* 심볼릭 링크는 대상을 따라가지 않고 같은 내용의 링크로 만든다 */
+static int copy_link(copy_dir_t *parent, const char *name)
+{
+    char    target[PATH_MAX];
+    ssize_t n = readlinkat(dirfd(parent->src), name, target, sizeof(target) - 1);
+
+    if (n < 0) {
+        return -1;
+    }
+    target[n] = '\0';
+    if (symlinkat(target, parent->dst, name) < 0) {
+        // 이미 있는 대상 디렉토리에 복사할 때는 파일처럼 덮어쓴다
+        if (errno != EEXIST || unlinkat(parent->dst, name, 0) < 0 || symlinkat(target, parent->dst, name) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void copy_file(workq_t *wq, int self, copy_task_t *task)
+{
+    tree_copy_t *tc = workq_arg(wq);
+    copy_dir_t *parent = task->parent;
+    const char *rel = task->rel;
+    struct stat st;
+    int src, dst;
+
+    // 링크를 따라가면 자기 트리를 가리키는 링크에서 끝없이 복사하게 되므로 링크 자체를 본다
+    if (fstatat(dirfd(parent->src), task->name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+        record_error(tc, rel, errno);
+        return;
+    }
+    if (S_ISLNK(st.st_mode)) {
+        if (copy_link(parent, task->name) < 0) {
+            record_error(tc, rel, errno);
+        } else {
+            copied(tc, 0);
+        }
+        return;
+    }
+
+    // 타입을 몰랐던 (DT_UNKNOWN) 디렉토리
+    if (S_ISDIR(st.st_mode)) {
+        if (make_dir(tc, parent, task->name, st.st_mode) < 0) {
+            record_error(tc, rel, errno);
+            return;
+        }
+        submit(wq, self, parent, rel, 1);
+        return;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        record_error(tc, rel, EOPNOTSUPP);   // 장치, FIFO, 소켓은 내용을 복사하지 않는다
+        return;
+    }
+
+    // 확인한 뒤에 링크나 FIFO 로 바뀌었으면 열지 않거나 멈추지 않게
+    src = openat(dirfd(parent->src), task->name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+    if (src < 0 || fstat(src, &st) < 0 || !S_ISREG(st.st_mode)) {
+        record_error(tc, rel, src < 0 || S_ISREG(st.st_mode) ? errno : EOPNOTSUPP);
+        if (src >= 0) close(src);
+        return;
+    }
+
+    dst = openat(parent->dst, task->name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0666);
+    if (dst < 0 || copy_fd(src, dst, &st, tc->ctl) < 0) {
+        if (errno != ECANCELED) {
+            record_error(tc, rel, errno);
+        }
+    } else {
+        copied(tc, st.st_size);
+    }
+    close(src);
+    if (dst >= 0) close(dst);
+}
+
+static void run_task(workq_t *wq, int self, void *arg)
+{
+    copy_task_t *task = arg;
+
+    if (task->is_dir) {
+        copy_dir(wq, self, task);
+    } else {
+        copy_file(wq, self, task);
+    }
+    dir_put(task->parent);
+    free(task);
+}
+
+/* 취소된 뒤에 남은 작업: 복사하지 않고 참조만 푼다 */
+static void drop_task(workq_t *wq, int self, void *arg)
+{
+    copy_task_t *task = arg;
+
+    (void)wq;
+    (void)self;
+    dir_put(task->parent);
+    free(task);
+}
+
+int tree_copy(int sdfd, const char *sname, int ddfd, const char *dname, tree_copy_stats_t *st,
+              const copy_ctl_t *ctl)
+{
+    tree_copy_t tc = { .st = st, .ctl = ctl, .lock = PTHREAD_MUTEX_INITIALIZER };
+    struct stat sst;
+
+    memset(st, 0, sizeof(*st));
+    if (fstatat(sdfd, sname, &sst, 0) < 0) {
+        record_error(&tc, sname, errno);
+        return -1;
+    }
+
+    if (!S_ISDIR(sst.st_mode)) {
+        // 파일 하나는 스레드 없이 바로
+        int src = openat(sdfd, sname, O_RDONLY | O_CLOEXEC);
+        int dst = src < 0 ? -1 : openat(ddfd, dname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+        if (dst < 0 || copy_fd(src, dst, &sst, ctl) < 0) {
+            if (errno != ECANCELED) {
+                record_error(&tc, src < 0 ? sname : dname, errno);
+            }
+        } else {
+            st->files = 1;
+            st->bytes = sst.st_size;
+            if (ctl && ctl->progress) {
+                ctl->progress(ctl->arg, 1, 0);
+            }
+        }
+        if (src >= 0) close(src);
+        if (dst >= 0) close(dst);
+        return st->errors ? -1 : 0;
+    }
+
+    tc.droot = -1;
+    tc.sroot = openat(sdfd, sname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (tc.sroot >= 0 && (mkdirat(ddfd, dname, (sst.st_mode & 07777) | S_IRWXU) == 0 || errno == EEXIST)) {
+        tc.droot = openat(ddfd, dname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (tc.sroot < 0 || tc.droot < 0) {
+        record_error(&tc, tc.sroot < 0 ? sname : dname, errno);
+        if (tc.sroot >= 0) close(tc.sroot);
+        return -1;
+    }
+    st->dirs = 1;
+
+    copy_task_t *root = calloc(1, sizeof(copy_task_t) + 1);
+    if (root == NULL) {
+        record_error(&tc, dname, ENOMEM);
+    } else {
+        root->is_dir = 1;
+        root->name = root->rel;
+        workq_run(run_task, drop_task, &tc, root, ctl ? ctl->cancel : NULL);
+    }
+
+    // 맨 위를 읽기 전에 취소됐어도 원래 권한으로
+    fchmod(tc.droot, sst.st_mode & 07777);
+
+    close(tc.sroot);
+    close(tc.droot);
+    return st->errors ? -1 : 0;
+}
+
+/* (ddfd, dname) 이 디렉토리 (sdfd, sname) 자신이거나 그 아래에 있으면 1.
+ * dname 의 부모부터 ".." 로 올라가면서 원본과 같은 디렉토리가 나오는지 본다 */
+int tree_contains(int sdfd, const char *sname, int ddfd, const char *dname)
+{
+    char   parent[PATH_MAX];
+    char  *slash;
+    struct stat src, st;
+    dev_t  dev = 0;
+    ino_t  ino = 0;     // 0 은 없는 inode 번호
+    int    fd, up, ret = 0;
+
+    if (fstatat(sdfd, sname, &src, 0) < 0 || !S_ISDIR(src.st_mode)) {
+        return 0;
+    }
+    if (fstatat(ddfd, dname, &st, 0) == 0 && st.st_dev == src.st_dev && st.st_ino == src.st_ino) {
+        return 1;
+    }
+
+    snprintf(parent, sizeof(parent), "%s", dname);
+    slash = strrchr(parent, '/');
+    if (slash == NULL) {
+        strcpy(parent, ".");
+    } else {
+        slash[slash == parent ? 1 : 0] = '\0';
+    }
+    if ((fd = openat(ddfd, parent, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        return 0;   // 부모가 없으면 복사할 때 실패한다
+    }
+
+    // 파일 시스템의 맨 위 ("/" 의 ".." 는 자기 자신) 까지
+    while (fd >= 0 && fstat(fd, &st) == 0 && !(st.st_dev == dev && st.st_ino == ino)) {
+        if (st.st_dev == src.st_dev && st.st_ino == src.st_ino) {
+            ret = 1;
+            break;
+        }
+        dev = st.st_dev;
+        ino = st.st_ino;
+        up = openat(fd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        close(fd);
+        fd = up;
+    }
+    if (fd >= 0) close(fd);
+    return ret;
+}
+
+/* 디렉토리 하나를 세고 하위 디렉토리로 내려간다. 심볼릭 링크는 복사할 때처럼 따라가지 않고
+ * 파일 하나 (0 바이트) 로 센다 */
+static int measure_dir(int fd, uint64_t *files, uint64_t *bytes, const int *cancel, int depth)
+{
+    DIR *dir = fdopendir(fd);
+    struct dirent *entry;
+    struct stat st;
+    int ret = 0;
+
+    if (dir == NULL) {
+        close(fd);
+        return 0;
+    }
+    while (ret == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED)) {
+            ret = -1;
+            break;
+        }
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+            continue;   // 복사할 때 오류로 남는다
+        }
+        if (S_ISDIR(st.st_mode)) {
+            int sub = depth < 256 ? openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) : -1;
+            if (sub >= 0) {
+                ret = measure_dir(sub, files, bytes, cancel, depth + 1);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            (*files)++;
+            *bytes += st.st_size;
+        } else if (S_ISLNK(st.st_mode)) {
+            (*files)++;
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+int tree_measure(int dfd, const char *name, uint64_t *files, uint64_t *bytes, const int *cancel)
+{
+    struct stat st;
+    int fd;
+
+    *files = *bytes = 0;
+    if (fstatat(dfd, name, &st, 0) < 0) {
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        *files = 1;
+        *bytes = st.st_size;
+        return 0;
+    }
+    fd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return fd < 0 ? 0 : measure_dir(fd, files, bytes, cancel, 0);
+}
+
+void tree_copy_stats_free(tree_copy_stats_t *st)
+{
+    for (int i = 0; i < st->nmsg; i++) {
+        free(st->msg[i]);
+    }
+    st->nmsg = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef MYSH_TREECOPY_H
+#define MYSH_TREECOPY_H
+
+#include <stdint.h>
+#include "copy.h"
+
+#define TREECOPY_MAX_ERRORS (32)    // 메시지를 남겨 두는 오류 수 (개수는 전부 센다)
+
+/* 복사 결과. 오류가 나도 나머지는 계속 복사하고 파일별로 기록한다 */
+typedef struct tree_copy_stats {
+    uint64_t    files;
+    uint64_t    dirs;
+    uint64_t    bytes;
+    uint64_t    errors;
+    int         nmsg;
+    char       *msg[TREECOPY_MAX_ERRORS];   // "<경로>: <오류>"
+} tree_copy_stats_t;
+
+/* (sdfd, sname) 을 (ddfd, dname) 으로 복사한다. 디렉토리면 트리 전체를 작업 스레드들이 나눠서.
+ * 트리 안의 심볼릭 링크는 따라가지 않고 링크로 만든다 (files 에 센다).
+ * ctl (NULL 가능) 로 진행 상황을 알리고, 취소되면 남은 작업을 버린다.
+ * 오류가 하나도 없으면 0. 결과는 tree_copy_stats_free 로 정리 */
+int  tree_copy(int sdfd, const char *sname, int ddfd, const char *dname, tree_copy_stats_t *st,
+               const copy_ctl_t *ctl);
+void tree_copy_stats_free(tree_copy_stats_t *st);
+
+/* (ddfd, dname) 이 디렉토리 (sdfd, sname) 자신이거나 그 아래에 있으면 1 (자기 안으로 복사하면 끝나지 않는다) */
+int  tree_contains(int sdfd, const char *sname, int ddfd, const char *dname);
+
+/* 복사할 파일 수와 바이트 수를 미리 센다 (진행률, 남은 시간 계산용). 취소되면 -1 */
+int  tree_measure(int dfd, const char *name, uint64_t *files, uint64_t *bytes, const int *cancel);
+
+#endif // MYSH_TREECOPY_H
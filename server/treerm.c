@@ -0,0 +1,249 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "treerm.h"
+#include "workq.h"
+
+#define TREERM_BUF_SIZE     (64 * 1024)     // 작업 스레드마다 쓰는 getdents64 버퍼
+#define TREERM_RETRIES      (2)             // 읽는 동안 새 항목이 생겨서 rmdir 이 실패하면 다시 읽는 횟수
+
+/* 커널이 getdents64 로 돌려주는 레코드 */
+struct linux_dirent64 {
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+/* 지울 디렉토리 하나. 자기 작업과 아직 남은 하위 디렉토리가 참조를 하나씩 잡고 있고,
+ * 마지막 참조가 풀리면 (아래가 다 지워지면) 자신을 지우고 부모의 참조를 푼다.
+ * 읽은 디렉토리는 열어 두고 자식은 그 fd 기준으로 열고 지운다 (중간 경로를 다시 따라가지 않게) */
+typedef struct rm_node {
+    struct rm_node *parent;     // NULL 이면 맨 위
+    long        refs;           // 원자적
+    int         fd;             // 이 디렉토리 (읽기 전이면 -1, 맨 위는 tr->root)
+    int         failed;         // 아래에 지우지 못한 항목이 있음 (원자적. 이러면 rmdir 은 시도하지 않는다)
+    int         retries;
+    const char *name;           // parent 안의 이름 (rel 의 마지막 요소)
+    char        rel[];          // 맨 위 기준 경로 ("" 이면 맨 위. 오류 메시지용)
+} rm_node_t;
+
+typedef struct tree_remove {
+    int         root;           // 지우는 트리의 맨 위 디렉토리
+    int         pdfd;           // 맨 위 자신의 위치
+    const char *name;
+    pthread_mutex_t lock;       // 오류 기록
+    tree_remove_stats_t *st;
+    const copy_ctl_t *ctl;
+    char       *buf[WORKQ_THREADS];     // 스레드 번호별 getdents64 버퍼
+} tree_remove_t;
+
+static void record_error(tree_remove_t *tr, const char *rel, int err)
+{
+    pthread_mutex_lock(&tr->lock);
+    tr->st->errors++;
+    if (tr->st->nmsg < TREERM_MAX_ERRORS &&
+        asprintf(&tr->st->msg[tr->st->nmsg], "%s: %s", *rel ? rel : tr->name, strerror(err)) >= 0) {
+        tr->st->nmsg++;
+    }
+    pthread_mutex_unlock(&tr->lock);
+}
+
+static void removed(tree_remove_t *tr, int is_dir)
+{
+    __atomic_add_fetch(is_dir ? &tr->st->dirs : &tr->st->files, 1, __ATOMIC_RELAXED);
+    if (tr->ctl && tr->ctl->progress) {
+        tr->ctl->progress(tr->ctl->arg, 1, 0);
+    }
+}
+
+static rm_node_t *node_new(rm_node_t *parent, const char *dir, const char *name)
+{
+    size_t len = strlen(dir) + 1 + strlen(name) + 1;
+    rm_node_t *node = malloc(sizeof(rm_node_t) + len);
+
+    if (node == NULL) {
+        return NULL;
+    }
+    node->parent = parent;
+    node->refs = 1;
+    node->fd = -1;
+    node->failed = 0;
+    node->retries = 0;
+    snprintf(node->rel, len, "%s%s%s", dir, *dir ? "/" : "", name);
+    node->name = node->rel + (*dir ? strlen(dir) + 1 : 0);
+    return node;
+}
+
+/* 참조 하나를 푼다. 마지막이면 디렉토리를 지우고 부모로 올라간다 */
+static void node_put(workq_t *wq, int self, rm_node_t *node)
+{
+    tree_remove_t *tr = workq_arg(wq);
+
+    while (node && __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        rm_node_t *parent = node->parent;
+        int ok = 0;
+
+        if (!__atomic_load_n(&node->failed, __ATOMIC_RELAXED) && !workq_cancelled(wq)) {
+            // 부모는 이 노드가 참조를 잡고 있어서 아직 열려 있다
+            int r = parent ? unlinkat(parent->fd, node->name, AT_REMOVEDIR)
+                           : unlinkat(tr->pdfd, tr->name, AT_REMOVEDIR);
+
+            if (r < 0 && errno == ENOTEMPTY && node->retries < TREERM_RETRIES) {
+                // 읽는 동안 다른 곳에서 새 항목을 만들었다. 열어 둔 fd 로 처음부터 한 번 더 읽는다
+                node->retries++;
+                node->refs = 1;
+                if (workq_submit(wq, self, node) == 0) {
+                    return;
+                }
+                errno = ENOMEM;
+            }
+            if (r == 0) {
+                removed(tr, 1);
+                ok = 1;
+            } else {
+                record_error(tr, node->rel, errno);
+            }
+        }
+
+        // 하나라도 남으면 위쪽 디렉토리들은 비지 않으므로 rmdir 하지 않는다
+        if (!ok && parent) {
+            __atomic_store_n(&parent->failed, 1, __ATOMIC_RELAXED);
+        }
+        if (parent && node->fd >= 0) {
+            close(node->fd);
+        }
+        free(node);
+        node = parent;
+    }
+}
+
+/* 디렉토리를 읽으면서 파일은 바로 지우고, 하위 디렉토리는 작업으로 넘긴다 */
+static void remove_dir(workq_t *wq, int self, void *arg)
+{
+    tree_remove_t *tr = workq_arg(wq);
+    rm_node_t *node = arg;
+    char  child[PATH_MAX];
+    long  n = 0;
+    int   fd;
+
+    // 부모 fd 기준으로 한 단계만 연다. 다시 읽을 때는 열어 둔 fd 를 되감는다
+    if (node->fd < 0) {
+        node->fd = openat(node->parent->fd, node->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    } else if (lseek(node->fd, 0, SEEK_SET) < 0) {
+        record_error(tr, node->rel, errno);
+        __atomic_store_n(&node->failed, 1, __ATOMIC_RELAXED);
+        node_put(wq, self, node);
+        return;
+    }
+    fd = node->fd;
+
+    if (fd < 0 || (tr->buf[self] == NULL && (tr->buf[self] = malloc(TREERM_BUF_SIZE)) == NULL)) {
+        record_error(tr, node->rel, fd < 0 ? errno : ENOMEM);
+        __atomic_store_n(&node->failed, 1, __ATOMIC_RELAXED);
+        node_put(wq, self, node);
+        return;
+    }
+
+    while (!workq_cancelled(wq) && (n = syscall(SYS_getdents64, fd, tr->buf[self], TREERM_BUF_SIZE)) > 0) {
+        for (long pos = 0; pos < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(tr->buf[self] + pos);
+            unsigned char type = d->d_type;
+            struct stat st;
+
+            pos += d->d_reclen;
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) {
+                continue;
+            }
+            if (type == DT_UNKNOWN && fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+            }
+
+            if (type == DT_DIR) {
+                rm_node_t *sub = node_new(node, node->rel, d->d_name);
+                __atomic_add_fetch(&node->refs, 1, __ATOMIC_RELAXED);
+                if (sub == NULL || workq_submit(wq, self, sub) < 0) {
+                    snprintf(child, sizeof(child), "%s%s%s", node->rel, *node->rel ? "/" : "", d->d_name);
+                    record_error(tr, child, ENOMEM);
+                    free(sub);
+                    __atomic_sub_fetch(&node->refs, 1, __ATOMIC_RELAXED);   // 자기 참조가 남아 있어서 0 이 되지 않음
+                    __atomic_store_n(&node->failed, 1, __ATOMIC_RELAXED);
+                }
+            } else if (unlinkat(fd, d->d_name, 0) == 0) {
+                removed(tr, 0);
+            } else if (errno != ENOENT) {
+                snprintf(child, sizeof(child), "%s%s%s", node->rel, *node->rel ? "/" : "", d->d_name);
+                record_error(tr, child, errno);
+                __atomic_store_n(&node->failed, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    if (n < 0) {
+        record_error(tr, node->rel, errno);
+        __atomic_store_n(&node->failed, 1, __ATOMIC_RELAXED);
+    }
+
+    node_put(wq, self, node);   // 자기 참조. 하위 디렉토리가 없으면 여기서 바로 rmdir
+}
+
+/* 취소된 뒤에 남은 작업: 지우지 않고 참조만 푼다 */
+static void drop_dir(workq_t *wq, int self, void *arg)
+{
+    node_put(wq, self, arg);
+}
+
+int tree_remove(int dfd, const char *name, tree_remove_stats_t *st, const copy_ctl_t *ctl)
+{
+    tree_remove_t tr = { .pdfd = dfd, .name = name, .st = st, .ctl = ctl, .lock = PTHREAD_MUTEX_INITIALIZER };
+    struct stat sst;
+    rm_node_t *root;
+
+    memset(st, 0, sizeof(*st));
+    if (fstatat(dfd, name, &sst, AT_SYMLINK_NOFOLLOW) < 0) {
+        record_error(&tr, name, errno);
+        return -1;
+    }
+
+    // 파일이나 심볼릭 링크는 스레드 없이 바로
+    if (!S_ISDIR(sst.st_mode)) {
+        if (unlinkat(dfd, name, 0) < 0) {
+            record_error(&tr, name, errno);
+        } else {
+            removed(&tr, 0);
+        }
+        return st->errors ? -1 : 0;
+    }
+
+    tr.root = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (tr.root < 0 || (root = node_new(NULL, "", "")) == NULL) {
+        record_error(&tr, name, tr.root < 0 ? errno : ENOMEM);
+        if (tr.root >= 0) close(tr.root);
+        return -1;
+    }
+    root->fd = tr.root;
+
+    workq_run(remove_dir, drop_dir, &tr, root, ctl ? ctl->cancel : NULL);
+
+    for (int i = 0; i < WORKQ_THREADS; i++) {
+        free(tr.buf[i]);
+    }
+    close(tr.root);
+    return st->errors ? -1 : 0;
+}
+
+void tree_remove_stats_free(tree_remove_stats_t *st)
+{
+    for (int i = 0; i < st->nmsg; i++) {
+        free(st->msg[i]);
+    }
+    st->nmsg = 0;
+}
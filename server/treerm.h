@@ -0,0 +1,24 @@
+#ifndef MYSH_TREERM_H
+#define MYSH_TREERM_H
+
+#include <stdint.h>
+#include "copy.h"
+
+#define TREERM_MAX_ERRORS   (32)    // 메시지를 남겨 두는 오류 수 (개수는 전부 센다)
+
+/* 삭제 결과. 지우지 못한 항목이 있어도 나머지는 계속 지운다 */
+typedef struct tree_remove_stats {
+    uint64_t    files;          // 디렉토리가 아닌 항목
+    uint64_t    dirs;
+    uint64_t    errors;
+    int         nmsg;
+    char       *msg[TREERM_MAX_ERRORS];     // "<경로>: <오류>"
+} tree_remove_stats_t;
+
+/* (dfd, name) 을 지운다. 디렉토리면 작업 스레드들이 하위 트리를 나눠서 아래부터 지운다.
+ * 심볼릭 링크는 따라가지 않는다. ctl (NULL 가능) 의 progress 는 지운 항목 수를 files 로 받는다.
+ * 오류가 하나도 없으면 0. 결과는 tree_remove_stats_free 로 정리 */
+int  tree_remove(int dfd, const char *name, tree_remove_stats_t *st, const copy_ctl_t *ctl);
+void tree_remove_stats_free(tree_remove_stats_t *st);
+
+#endif // MYSH_TREERM_H
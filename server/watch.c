@@ -0,0 +1,395 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include "watch.h"
+#include "frame.h"
+#include "dcache.h"
+
+#define WATCH_MASK  (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_MODIFY | \
+                     IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* 같은 inode 를 여러 세션이 보면 inotify 는 같은 wd 를 돌려준다. wd 하나에 감시자 목록 */
+typedef struct watcher {
+    session_watch_t *w;
+    void           *cache;      // kind 가 WATCH_CACHE 이면 dcache 항목
+    int             kind;       // 0: 디렉토리, NOTIFY_FILE: 파일, WATCH_CACHE
+    struct watcher *next;
+} watcher_t;
+
+static int inotify_fd = -1;
+static int timer_fd = -1;
+static int timer_armed;
+static watcher_t **by_wd;       // wd -> 감시자 목록
+static int wd_cap;
+static session_watch_t *pending; // 알림을 보내야 하는 세션
+
+int watch_init(void)
+{
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("timerfd_create");
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int watch_inotify_fd(void)
+{
+    return inotify_fd;
+}
+
+int watch_timer_fd(void)
+{
+    return timer_fd;
+}
+
+static session_watch_t *watch_of(session_t *s)
+{
+    if (s->watch == NULL) {
+        s->watch = calloc(1, sizeof(session_watch_t));
+        if (s->watch == NULL) {
+            return NULL;
+        }
+        s->watch->s = s;
+        s->watch->dir_wd = -1;
+        s->watch->file_wd = -1;
+    }
+    return s->watch;
+}
+
+/* fd 가 가리키는 파일/디렉토리에 감시자를 붙인다. 성공하면 wd */
+static int watcher_add(session_watch_t *w, void *cache, int fd, int kind)
+{
+    char path[64];
+    int  wd;
+
+    // 경로 대신 fd 로 (chroot 안의 상대 경로를 다시 풀지 않아도 됨)
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+    if (wd < 0) {
+        return -1;
+    }
+
+    if (wd >= wd_cap) {
+        int cap = wd_cap ? wd_cap : 64;
+        while (cap <= wd) cap *= 2;
+
+        watcher_t **p = realloc(by_wd, sizeof(watcher_t *) * cap);
+        if (p == NULL) {
+            return -1;
+        }
+        memset(p + wd_cap, 0, sizeof(watcher_t *) * (cap - wd_cap));
+        by_wd = p;
+        wd_cap = cap;
+    }
+
+    watcher_t *n = malloc(sizeof(watcher_t));
+    if (n == NULL) {
+        return -1;
+    }
+    n->w = w;
+    n->cache = cache;
+    n->kind = kind;
+    n->next = by_wd[wd];
+    by_wd[wd] = n;
+    return wd;
+}
+
+/* 감시자를 떼고, 그 wd 를 보는 세션이 더 없으면 inotify 감시도 지운다 */
+static void watcher_remove(session_watch_t *w, void *cache, int wd, int kind)
+{
+    if (wd < 0 || wd >= wd_cap) {
+        return;
+    }
+
+    for (watcher_t **pp = &by_wd[wd]; *pp; pp = &(*pp)->next) {
+        if ((*pp)->w == w && (*pp)->cache == cache && (*pp)->kind == kind) {
+            watcher_t *n = *pp;
+            *pp = n->next;
+            free(n);
+            break;
+        }
+    }
+    if (by_wd[wd] == NULL) {
+        inotify_rm_watch(inotify_fd, wd);
+    }
+}
+
+void watch_dir(session_t *s)
+{
+    session_watch_t *w;
+
+    if (inotify_fd < 0 || (w = watch_of(s)) == NULL) {
+        return;
+    }
+
+    // 같은 디렉토리면 wd 도 같다. 새로 붙이고 나서 떼야 감시가 끊기지 않는다
+    int old = w->dir_wd;
+    w->dir_wd = watcher_add(w, NULL, s->cwd_fd, 0);
+    watcher_remove(w, NULL, old, 0);
+
+    // 이전 디렉토리에서 모아 둔 변경은 의미가 없다
+    w->dirty = 0;
+    w->nnames = 0;
+    w->names_len = 0;
+}
+
+int watch_file(session_t *s, int dfd, const char *rel)
+{
+    session_watch_t *w;
+    int fd, wd = -1;
+
+    if (inotify_fd < 0 || (w = watch_of(s)) == NULL) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    if (rel != NULL) {
+        fd = openat(dfd, rel, O_PATH | O_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        wd = watcher_add(w, NULL, fd, NOTIFY_FILE);
+        close(fd);
+        if (wd < 0) {
+            return -1;
+        }
+    }
+
+    watcher_remove(w, NULL, w->file_wd, NOTIFY_FILE);
+    w->file_wd = wd;
+    w->notify &= ~NOTIFY_FILE;
+    return 0;
+}
+
+static void pending_remove(session_watch_t *w)
+{
+    for (session_watch_t **pp = &pending; *pp; pp = &(*pp)->next_pending) {
+        if (*pp == w) {
+            *pp = w->next_pending;
+            break;
+        }
+    }
+    w->next_pending = NULL;
+}
+
+void watch_forget(session_t *s)
+{
+    session_watch_t *w = s->watch;
+
+    if (w == NULL) {
+        return;
+    }
+
+    if (w->queued) {
+        pending_remove(w);
+    }
+    watcher_remove(w, NULL, w->dir_wd, 0);
+    watcher_remove(w, NULL, w->file_wd, NOTIFY_FILE);
+    free(w->names);
+    free(w);
+    s->watch = NULL;
+}
+
+int watch_cache_add(int fd, void *owner)
+{
+    return inotify_fd < 0 ? -1 : watcher_add(NULL, owner, fd, WATCH_CACHE);
+}
+
+void watch_cache_remove(int wd, void *owner)
+{
+    watcher_remove(NULL, owner, wd, WATCH_CACHE);
+}
+
+static void timer_arm(void)
+{
+    struct itimerspec its = { .it_value = { 0, WATCH_INTERVAL_MS * 1000000L } };
+
+    if (!timer_armed && timerfd_settime(timer_fd, 0, &its, NULL) == 0) {
+        timer_armed = 1;
+    }
+}
+
+/* 세션에 보낼 변경을 기록하고 다음 타이머에서 한꺼번에 보낸다 */
+static void watch_mark(session_watch_t *w, int kind, const char *name)
+{
+    if (!w->queued) {
+        w->next_pending = pending;
+        pending = w;
+        w->queued = 1;
+    }
+    timer_arm();
+
+    if (kind == NOTIFY_FILE) {
+        w->notify |= NOTIFY_FILE;
+        return;
+    }
+
+    w->dirty = 1;
+    if (w->notify & NOTIFY_RESCAN) {
+        return;
+    }
+
+    size_t len = strlen(name) + 1;
+    if (w->nnames >= WATCH_MAX_NAMES) {
+        w->notify |= NOTIFY_RESCAN;
+        return;
+    }
+    if (w->names_len + len > w->names_cap) {
+        size_t cap = w->names_cap ? w->names_cap * 2 : 4096;
+        while (cap < w->names_len + len) cap *= 2;
+
+        char *p = realloc(w->names, cap);
+        if (p == NULL) {
+            w->notify |= NOTIFY_RESCAN;
+            return;
+        }
+        w->names = p;
+        w->names_cap = cap;
+    }
+    memcpy(w->names + w->names_len, name, len);
+    w->names_len += len;
+    w->nnames++;
+}
+
+/* inotify 가 감시를 지웠다 (대상 삭제 등). 보던 세션들은 wd 를 잃는다 */
+static void watch_ignored(int wd)
+{
+    watcher_t *n = by_wd[wd];
+
+    by_wd[wd] = NULL;
+    while (n) {
+        watcher_t *next = n->next;
+        if (n->kind == WATCH_CACHE) {
+            dcache_event(n->cache, 1);
+        } else if (n->kind == NOTIFY_FILE) {
+            n->w->file_wd = -1;
+        } else {
+            n->w->dir_wd = -1;
+        }
+        free(n);
+        n = next;
+    }
+}
+
+void watch_handle_inotify(void)
+{
+    char buf[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (1) {
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) perror("read inotify");
+            return;
+        }
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // 이벤트를 잃었으면 캐시를 비우고 모든 세션이 다시 스캔해야 한다
+                dcache_flush();
+                for (int wd = 0; wd < wd_cap; wd++) {
+                    for (watcher_t *n = by_wd[wd]; n; n = n->next) {
+                        if (n->kind == WATCH_CACHE) continue;
+                        watch_mark(n->w, n->kind, ".");
+                        n->w->notify |= n->kind == NOTIFY_FILE ? NOTIFY_FILE : NOTIFY_RESCAN;
+                    }
+                }
+                continue;
+            }
+            if (ev->wd < 0 || ev->wd >= wd_cap) {
+                continue;
+            }
+
+            // 디렉토리 자신에 대한 이벤트는 이름이 없다 -> "." 항목이 바뀜
+            for (watcher_t *n = by_wd[ev->wd]; n; n = n->next) {
+                if (n->kind == WATCH_CACHE) {
+                    dcache_event(n->cache, 0);
+                } else {
+                    watch_mark(n->w, n->kind, ev->len ? ev->name : ".");
+                }
+            }
+            if (ev->mask & IN_IGNORED) {
+                watch_ignored(ev->wd);
+            }
+        }
+    }
+}
+
+/* 모아 둔 변경을 세션마다 한 번에 보낸다 (request id 0 응답).
+ * 응답을 스트리밍하는 중인 세션은 순서가 섞이지 않게 다음 타이머로 미룬다 */
+void watch_handle_timer(void)
+{
+    uint64_t expirations;
+    session_watch_t *list = pending;
+
+    if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        perror("read timerfd");
+    }
+    timer_armed = 0;
+    pending = NULL;
+
+    while (list) {
+        session_watch_t *w = list;
+        session_t *s = w->s;
+        list = w->next_pending;
+        w->next_pending = NULL;
+        w->queued = 0;
+
+        if (s->producer || s->sf_left > 0 || s->ref_left > 0) {
+            w->next_pending = pending;
+            pending = w;
+            w->queued = 1;
+            continue;
+        }
+
+        uint32_t saved_id = s->req_id;
+        int sent = 0;
+
+        cur_session = s;
+        s->req_id = 0;
+        if (w->dirty && !(w->notify & NOTIFY_RESCAN)) {
+            sent = snapshot_push(w->names, w->names_len);
+            if (sent < 0) {
+                w->notify |= NOTIFY_RESCAN;
+            }
+        }
+        if (w->notify) {
+            send_frame(FT_NOTIFY, &w->notify, sizeof(w->notify));
+            sent = 1;
+        }
+        if (sent) {
+            int32_t status = htonl(0);
+            send_frame(FT_END, &status, sizeof(status));
+        }
+        s->req_id = saved_id;
+        cur_session = NULL;
+
+        w->notify = 0;
+        w->dirty = 0;
+        w->nnames = 0;
+        w->names_len = 0;
+    }
+
+    if (pending) {
+        timer_arm();
+    }
+}
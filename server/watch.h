@@ -0,0 +1,43 @@
+#ifndef MYSH_WATCH_H
+#define MYSH_WATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mysh.h"
+
+#define WATCH_INTERVAL_MS   (100)   // 이 간격 동안 생긴 변경을 모아서 한 번에 알린다
+#define WATCH_MAX_NAMES     (256)   // 이보다 많이 바뀌면 이름 대신 다시 스캔하라고 알린다
+
+/* FT_NOTIFY payload (uint8) 비트 */
+#define NOTIFY_RESCAN       (0x01)  // 현재 디렉토리 변경분을 다 못 모았음 ("ls since" 필요)
+#define NOTIFY_FILE         (0x02)  // watch 로 지정한 파일이 바뀜
+
+#define WATCH_CACHE         (0x80)  // 세션이 아니라 디렉토리 캐시 (dcache) 의 감시
+
+/* 세션 하나가 보고 있는 디렉토리/파일과 아직 알리지 않은 변경 */
+typedef struct session_watch {
+    session_t  *s;
+    int         dir_wd;         // 현재 디렉토리 (-1 이면 없음)
+    int         file_wd;        // 뷰어에 열린 파일 (-1 이면 없음)
+    int         queued;         // pending 목록에 있음
+    uint8_t     notify;         // 보낼 NOTIFY_* 비트
+    int         dirty;          // 현재 디렉토리가 바뀜 (names 또는 NOTIFY_RESCAN)
+    char       *names;          // 바뀐 이름 (NUL 로 구분)
+    size_t      names_len;
+    size_t      names_cap;
+    int         nnames;
+    struct session_watch *next_pending;
+} session_watch_t;
+
+int  watch_init(void);
+int  watch_inotify_fd(void);
+int  watch_timer_fd(void);
+void watch_dir(session_t *s);                   // 세션의 cwd_fd 를 감시
+int  watch_file(session_t *s, int dfd, const char *rel); // rel == NULL 이면 해제
+void watch_forget(session_t *s);
+int  watch_cache_add(int fd, void *owner);      // 바뀌면 dcache_event(owner) 를 부른다
+void watch_cache_remove(int wd, void *owner);
+void watch_handle_inotify(void);
+void watch_handle_timer(void);
+
+#endif // MYSH_WATCH_H
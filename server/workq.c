@@ -0,0 +1,196 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "workq.h"
+
+/* 작업 스레드마다 하나. 자기 것은 tail 에서, 훔칠 때는 head 에서 */
+typedef struct deque {
+    pthread_mutex_t lock;
+    void          **task;
+    int             head;       // [head, tail) 이 들어 있는 작업
+    int             tail;
+    int             cap;
+} deque_t;
+
+struct workq {
+    int         nworkers;
+    deque_t     dq[WORKQ_THREADS];
+    long        pending;        // 아직 끝나지 않은 작업 수 (원자적)
+    long        queued;         // 덱에 들어 있는 작업 수 (원자적)
+    int         sleepers;       // 일이 없어서 기다리는 스레드 수 (원자적)
+    pthread_mutex_t lock;       // 잠들기/깨우기
+    pthread_cond_t  more;
+    workq_func_t func;
+    workq_func_t drop;
+    void       *arg;
+    const int  *cancel;
+};
+
+typedef struct worker {
+    workq_t    *wq;
+    int         id;
+} worker_t;
+
+static int deque_push(deque_t *dq, void *task)
+{
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail == dq->cap) {
+        if (dq->head > 0) {
+            memmove(dq->task, dq->task + dq->head, sizeof(void *) * (dq->tail - dq->head));
+            dq->tail -= dq->head;
+            dq->head = 0;
+        } else {
+            int cap = dq->cap ? dq->cap * 2 : 256;
+            void **p = realloc(dq->task, sizeof(void *) * cap);
+            if (p == NULL) {
+                pthread_mutex_unlock(&dq->lock);
+                return -1;
+            }
+            dq->task = p;
+            dq->cap = cap;
+        }
+    }
+    dq->task[dq->tail++] = task;
+    pthread_mutex_unlock(&dq->lock);
+    return 0;
+}
+
+static void *deque_take(deque_t *dq, int steal)
+{
+    void *task = NULL;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->head < dq->tail) {
+        task = steal ? dq->task[dq->head++] : dq->task[--dq->tail];
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return task;
+}
+
+/* self 의 덱에 작업을 넣고, 일이 없어서 자는 스레드가 있으면 깨운다 */
+int workq_submit(workq_t *wq, int self, void *task)
+{
+    __atomic_add_fetch(&wq->pending, 1, __ATOMIC_SEQ_CST);
+    if (deque_push(&wq->dq[self], task) < 0) {
+        __atomic_sub_fetch(&wq->pending, 1, __ATOMIC_SEQ_CST);
+        return -1;
+    }
+    __atomic_add_fetch(&wq->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&wq->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&wq->lock);
+        pthread_cond_signal(&wq->more);
+        pthread_mutex_unlock(&wq->lock);
+    }
+    return 0;
+}
+
+void *workq_arg(const workq_t *wq)
+{
+    return wq->arg;
+}
+
+int workq_cancelled(const workq_t *wq)
+{
+    return wq->cancel && __atomic_load_n(wq->cancel, __ATOMIC_RELAXED);
+}
+
+/* 자기 덱에서 먼저, 없으면 다른 스레드의 덱에서 훔친다 */
+static void *find_task(workq_t *wq, int self)
+{
+    void *task = deque_take(&wq->dq[self], 0);
+
+    for (int i = 1; task == NULL && i < wq->nworkers; i++) {
+        task = deque_take(&wq->dq[(self + i) % wq->nworkers], 1);
+    }
+    if (task) {
+        __atomic_sub_fetch(&wq->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    return task;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    workq_t  *wq = w->wq;
+
+    while (1) {
+        void *task = find_task(wq, w->id);
+
+        if (task) {
+            if (!workq_cancelled(wq)) {
+                wq->func(wq, w->id, task);
+            } else if (wq->drop) {
+                wq->drop(wq, w->id, task);  // 취소됨: 실행하지 않고 정리만
+            } else {
+                free(task);
+            }
+
+            // 마지막 작업이면 기다리는 스레드들을 끝낸다
+            if (__atomic_sub_fetch(&wq->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+                pthread_mutex_lock(&wq->lock);
+                pthread_cond_broadcast(&wq->more);
+                pthread_mutex_unlock(&wq->lock);
+            }
+            continue;
+        }
+
+        // 덱이 모두 비었다. 누가 작업을 넣거나 전체가 끝날 때까지 잔다
+        pthread_mutex_lock(&wq->lock);
+        __atomic_add_fetch(&wq->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&wq->pending, __ATOMIC_SEQ_CST) > 0 &&
+               __atomic_load_n(&wq->queued, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&wq->more, &wq->lock);
+        }
+        __atomic_sub_fetch(&wq->sleepers, 1, __ATOMIC_SEQ_CST);
+        int done = __atomic_load_n(&wq->pending, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&wq->lock);
+        if (done) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int worker_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN) * 2;    // 메타데이터 작업은 대부분 I/O 대기
+
+    return n < 4 ? 4 : n > WORKQ_THREADS ? WORKQ_THREADS : (int)n;
+}
+
+void workq_run(workq_func_t func, workq_func_t drop, void *arg, void *first, const int *cancel)
+{
+    workq_t   wq = { .func = func, .drop = drop, .arg = arg, .cancel = cancel,
+                     .lock = PTHREAD_MUTEX_INITIALIZER, .more = PTHREAD_COND_INITIALIZER };
+    pthread_t tid[WORKQ_THREADS];
+    worker_t  w[WORKQ_THREADS];
+    int       started = 1;
+
+    wq.nworkers = worker_count();
+    for (int i = 0; i < wq.nworkers; i++) {
+        pthread_mutex_init(&wq.dq[i].lock, NULL);
+        w[i].wq = &wq;
+        w[i].id = i;
+    }
+
+    if (workq_submit(&wq, 0, first) < 0) {
+        func(&wq, 0, first);    // 덱을 못 만들었으면 이 스레드에서 바로 (새 작업은 실패로 처리됨)
+    }
+    for (; started < wq.nworkers; started++) {
+        if (pthread_create(&tid[started], NULL, worker_main, &w[started]) != 0) {
+            break;  // 만든 만큼만으로 진행 (덱은 남은 스레드들이 훔쳐 간다)
+        }
+    }
+    worker_main(&w[0]);     // 호출한 스레드도 같이 일한다
+    for (int i = 1; i < started; i++) {
+        pthread_join(tid[i], NULL);
+    }
+
+    for (int i = 0; i < wq.nworkers; i++) {
+        pthread_mutex_destroy(&wq.dq[i].lock);
+        free(wq.dq[i].task);
+    }
+}
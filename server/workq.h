@@ -0,0 +1,21 @@
+#ifndef MYSH_WORKQ_H
+#define MYSH_WORKQ_H
+
+#define WORKQ_THREADS       (16)    // 최대 작업 스레드 수 (호출한 스레드 포함)
+
+/* 트리 작업 (복사, 삭제) 을 여러 스레드가 나눠 하는 작업 큐.
+ * 스레드마다 덱이 있어서 자기가 만든 작업은 tail 에서 (깊이 우선), 일이 없으면
+ * 다른 스레드의 head 에서 훔쳐 간다 (큰 하위 트리) */
+typedef struct workq workq_t;
+
+/* 작업 하나를 실행한다. self 는 실행 중인 스레드 번호 (새 작업은 workq_submit(wq, self, ...)) */
+typedef void (*workq_func_t)(workq_t *wq, int self, void *task);
+
+/* first 작업부터 시작해서 작업이 더 없을 때까지 돌린다. 호출한 스레드도 같이 일한다.
+ * cancel 이 세워지면 남은 작업은 func 대신 drop 에 넘긴다 (drop 이 NULL 이면 free) */
+void  workq_run(workq_func_t func, workq_func_t drop, void *arg, void *first, const int *cancel);
+int   workq_submit(workq_t *wq, int self, void *task);  // 실패하면 -1 (task 는 그대로)
+void *workq_arg(const workq_t *wq);
+int   workq_cancelled(const workq_t *wq);
+
+#endif // MYSH_WORKQ_H